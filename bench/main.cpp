@@ -0,0 +1,374 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#define MOD8_PARAM_MIXING_FREQ 48000
+#include <AVRModPlay.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Seconds = std::chrono::duration<double>;
+
+//------------------------------------------------------------------------------
+struct Options {
+  std::vector<std::filesystem::path> inputs;
+  unsigned repetitions = 3;
+  bool json = false;
+};
+
+//------------------------------------------------------------------------------
+struct Result {
+  std::string name;
+  uint64_t frames = 0;
+  double best_seconds = 0.0;   // Best render time of all repetitions.
+  double mean_seconds = 0.0;   // Mean render time of all repetitions.
+  double tick_seconds = 0.0;   // Time spent in tick(), measured in a separate pass.
+  double update_seconds = 0.0; // Time spent in update(), measured in a separate pass.
+};
+
+//------------------------------------------------------------------------------
+double audio_seconds(uint64_t frames) {
+  return static_cast<double>(frames) / mod8::config::MIXING_FREQ;
+}
+
+//------------------------------------------------------------------------------
+double frames_per_second(uint64_t frames, double seconds) {
+  return seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0;
+}
+
+//------------------------------------------------------------------------------
+double share(double part, double whole) {
+  return whole > 0.0 ? part / whole : 0.0;
+}
+
+//------------------------------------------------------------------------------
+/// The sampler may read one byte past the end of a sample, the block mixer too.
+/// Keep it in the buffer if the sample is the last one in file, as the test application does.
+constexpr size_t SONG_GUARD_SIZE = 16;
+
+//------------------------------------------------------------------------------
+bool read_file(const std::filesystem::path &path, std::vector<uint8_t> &data) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+//------------------------------------------------------------------------------
+/// Renders the whole song in blocks, without any output.
+uint64_t render_song(mod8::Player &player, const std::vector<uint8_t> &song, size_t song_size) {
+  constexpr size_t FRAMES_PER_BLOCK = 4096;
+  int16_t frames[FRAMES_PER_BLOCK * 2];
+
+  player.load(song.data(), song_size);
+
+  uint64_t frame_count = 0;
+  for (;;) {
+    const size_t rendered = player.render(frames, FRAMES_PER_BLOCK);
+    if (rendered == 0) {
+      break;
+    }
+
+    frame_count += rendered;
+  }
+
+  return frame_count;
+}
+
+//------------------------------------------------------------------------------
+/// Average cost of a Clock::now() call, to subtract it from measured intervals.
+double clock_overhead_seconds() {
+  constexpr unsigned COUNT = 1000000;
+
+  const auto begin = Clock::now();
+  Clock::time_point last{};
+  for (unsigned i = 0; i != COUNT; ++i) {
+    last = Clock::now();
+  }
+
+  return Seconds(last - begin).count() / COUNT;
+}
+
+//------------------------------------------------------------------------------
+/// Renders the whole song frame by frame, timing update() and tick() separately.
+/// The clock reads make this pass much slower than render_song().
+void measure_split(mod8::Player &player, const std::vector<uint8_t> &song, size_t song_size,
+                   Result &result) {
+  static const double CLOCK_OVERHEAD = clock_overhead_seconds();
+
+  player.load(song.data(), song_size);
+
+  Clock::duration tick_time{};
+  Clock::duration update_time{};
+  uint64_t frame_count = 0;
+
+  for (;;) {
+    const auto t0 = Clock::now();
+    const auto state = player.update();
+    const auto t1 = Clock::now();
+
+    if (state == mod8::Player::UpdateResult::INACTIVE) {
+      break;
+    }
+
+    player.tick();
+    const auto t2 = Clock::now();
+
+    update_time += t1 - t0;
+    tick_time += t2 - t1;
+    ++frame_count;
+  }
+
+  const double overhead = CLOCK_OVERHEAD * static_cast<double>(frame_count);
+  result.tick_seconds = std::max(0.0, Seconds(tick_time).count() - overhead);
+  result.update_seconds = std::max(0.0, Seconds(update_time).count() - overhead);
+}
+
+//------------------------------------------------------------------------------
+bool bench_song(mod8::Player &player, const std::filesystem::path &path, unsigned repetitions,
+                Result &result) {
+  std::vector<uint8_t> song;
+  if (!read_file(path, song) || song.empty()) {
+    fprintf(stderr, "Unable to read file: %s\n", path.string().c_str());
+    return false;
+  }
+
+  const size_t song_size = song.size();
+  song.resize(song_size + SONG_GUARD_SIZE);
+
+  player.init();
+  if (!player.load(song.data(), song_size)) {
+    fprintf(stderr, "Parse error: %s\n", path.string().c_str());
+    return false;
+  }
+
+  result.name = path.filename().string();
+
+  double total_seconds = 0.0;
+  for (unsigned i = 0; i != repetitions; ++i) {
+    const auto begin = Clock::now();
+    result.frames = render_song(player, song, song_size);
+    const double seconds = Seconds(Clock::now() - begin).count();
+
+    total_seconds += seconds;
+    if (i == 0 || seconds < result.best_seconds) {
+      result.best_seconds = seconds;
+    }
+  }
+
+  result.mean_seconds = total_seconds / repetitions;
+
+  measure_split(player, song, song_size, result);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::string json_escape(const std::string &text) {
+  std::string escaped;
+
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20U) {
+      char buffer[8];
+      snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      escaped += buffer;
+    } else {
+      escaped += c;
+    }
+  }
+
+  return escaped;
+}
+
+//------------------------------------------------------------------------------
+void print_text(const Result &r) {
+  const double split = r.tick_seconds + r.update_seconds;
+
+  printf("%-32s %10.0f fps %8.1fx realtime  tick %5.1f%%  update %5.1f%%\n",
+         r.name.c_str(),
+         frames_per_second(r.frames, r.best_seconds),
+         share(audio_seconds(r.frames), r.best_seconds),
+         100.0 * share(r.tick_seconds, split),
+         100.0 * share(r.update_seconds, split));
+}
+
+//------------------------------------------------------------------------------
+void print_json(const Result &r, const char *indent) {
+  const double split = r.tick_seconds + r.update_seconds;
+
+  printf("%s\"name\": \"%s\",\n", indent, json_escape(r.name).c_str());
+  printf("%s\"frames\": %llu,\n", indent, static_cast<unsigned long long>(r.frames));
+  printf("%s\"audio_seconds\": %.6f,\n", indent, audio_seconds(r.frames));
+  printf("%s\"best_seconds\": %.6f,\n", indent, r.best_seconds);
+  printf("%s\"mean_seconds\": %.6f,\n", indent, r.mean_seconds);
+  printf("%s\"frames_per_second\": %.1f,\n", indent, frames_per_second(r.frames, r.best_seconds));
+  printf("%s\"realtime_factor\": %.3f,\n", indent, share(audio_seconds(r.frames), r.best_seconds));
+  printf("%s\"tick_share\": %.4f,\n", indent, share(r.tick_seconds, split));
+  printf("%s\"update_share\": %.4f\n", indent, share(r.update_seconds, split));
+}
+
+//------------------------------------------------------------------------------
+void print_usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [-r <repetitions>] [--json] [<file.mod> | <directory>]...\n"
+          "Default input: %s\n",
+          program,
+          AVRMODPLAY_SONGS_DIR);
+}
+
+//------------------------------------------------------------------------------
+bool parse_options(int argc, char *argv[], Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+
+    if (arg == "--json") {
+      options.json = true;
+    } else if (arg == "-r" && i + 1 < argc) {
+      const int repetitions = atoi(argv[++i]);
+      if (repetitions <= 0) {
+        return false;
+      }
+
+      options.repetitions = static_cast<unsigned>(repetitions);
+    } else if (!arg.empty() && arg[0] == '-') {
+      return false;
+    } else {
+      options.inputs.emplace_back(arg);
+    }
+  }
+
+  if (options.inputs.empty()) {
+    options.inputs.emplace_back(AVRMODPLAY_SONGS_DIR);
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::filesystem::path> collect_songs(const std::vector<std::filesystem::path> &inputs) {
+  std::vector<std::filesystem::path> songs;
+  std::error_code error;
+
+  for (const auto &input : inputs) {
+    if (!std::filesystem::is_directory(input, error)) {
+      songs.push_back(input);
+      continue;
+    }
+
+    std::vector<std::filesystem::path> found;
+    for (const auto &entry : std::filesystem::directory_iterator(input, error)) {
+      if (entry.is_regular_file(error) && entry.path().extension() == ".mod") {
+        found.push_back(entry.path());
+      }
+    }
+
+    std::sort(found.begin(), found.end());
+    songs.insert(songs.end(), found.begin(), found.end());
+  }
+
+  return songs;
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!parse_options(argc, argv, options)) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const auto songs = collect_songs(options.inputs);
+  if (songs.empty()) {
+    fprintf(stderr, "No songs found\n");
+    return EXIT_FAILURE;
+  }
+
+  //----------------------------------------------------------------------------
+  auto player = std::make_unique<mod8::Player>();
+
+  std::vector<Result> results;
+  Result total;
+  total.name = "TOTAL";
+
+  for (const auto &path : songs) {
+    Result result;
+    if (!bench_song(*player, path, options.repetitions, result)) {
+      return EXIT_FAILURE;
+    }
+
+    total.frames += result.frames;
+    total.best_seconds += result.best_seconds;
+    total.mean_seconds += result.mean_seconds;
+    total.tick_seconds += result.tick_seconds;
+    total.update_seconds += result.update_seconds;
+
+    if (!options.json) {
+      print_text(result);
+    }
+
+    results.push_back(std::move(result));
+  }
+
+  //----------------------------------------------------------------------------
+  if (options.json) {
+    printf("{\n");
+    printf("  \"mixing_freq\": %u,\n", static_cast<unsigned>(mod8::config::MIXING_FREQ));
+    printf("  \"repetitions\": %u,\n", options.repetitions);
+    printf("  \"songs\": [\n");
+
+    for (size_t i = 0; i != results.size(); ++i) {
+      printf("    {\n");
+      print_json(results[i], "      ");
+      printf("    }%s\n", i + 1 != results.size() ? "," : "");
+    }
+
+    printf("  ],\n");
+    printf("  \"total\": {\n");
+    print_json(total, "    ");
+    printf("  }\n");
+    printf("}\n");
+  } else {
+    print_text(total);
+  }
+
+  return EXIT_SUCCESS;
+}
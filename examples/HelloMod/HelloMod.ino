@@ -1259,7 +1259,8 @@ static const uint8_t PROGMEM g_song[] = {
   0x00, 0x00
 };
 
-static mod8::Player g_player;
+// The player keeps the PWM duty cycles of the frame, see mod8::output for other formats.
+static mod8::BasicPlayer<mod8::DefaultSongTraits, 4, mod8::output::StereoPwm8> g_player;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Timer #1 interrupt routine.
@@ -1269,9 +1270,8 @@ ISR(TIMER1_OVF_vect) {
   // then go on to calculate the next value to be used.
 
   // Update PWM Output Compare Registers.
-  // Converts a signed 8-bit integer to an unsigned integer suitable for PWM.
-  OCR1AL = g_player.output_left_u8() + 0x80U;
-  OCR1BL = g_player.output_right_u8() + 0x80U;
+  OCR1AL = g_player.output().left;
+  OCR1BL = g_player.output().right;
 
   // Fetch next samples.
   g_player.tick();
@@ -1331,4 +1331,7 @@ void setup() {
 void loop() {
   // Update notes, fetch next rows in patterns, etc.
   g_player.update();
+
+  // Sleep until the next player tick is due, the interrupts still play the sound.
+  g_player.wait_for_tick();
 }
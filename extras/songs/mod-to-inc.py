@@ -1,6 +1,40 @@
 #!/usr/bin/env python3
 
+import argparse
 import glob
+import os
+import re
+
+NUM_CHANNELS = 4
+NUM_ROWS = 64
+NUM_SAMPLES = 31
+SONG_HEADER_SIZE = 1084
+ORDERS_OFFSET = 952
+NUM_ORDERS = 128
+
+# Opcodes of mod8::Opcode: the effect number, or 0x10 + x for extended effects Ex.
+OPCODE_EXTENDED = 0x10
+
+SAMPLES_OFFSET = 20
+SAMPLE_HEADER_SIZE = 30
+SONG_LENGTH_OFFSET = 950
+
+EFFECT_SAMPLE_OFFSET = 0x9
+EFFECT_POSITION_JUMP = 0xB
+EFFECT_PATTERN_BREAK = 0xD
+EFFECT_PATTERN_LOOP = 0xE6
+
+# Compressed sample data, see mod8::format::DELTA4_SIGNATURE.
+DELTA4_SIGNATURE = b"M8D4"
+DELTA4_TABLE_LENGTH = 16
+DELTA4_BLOCK_LENGTH = 256
+# Shorter samples are mostly drums, they lose too much.
+DELTA4_MIN_LENGTH = 1024
+
+# Limits of mod8::format, the tags give the number of channels.
+SUPPORTED_TAGS = {b"M.K.": 4, b"4CHN": 4, b"FLT4": 4, b"6CHN": 6, b"8CHN": 8, b"OCTA": 8}
+MAX_FINETUNE = 15
+MAX_VOLUME = 64
 
 
 def to_hex_list(data):
@@ -14,9 +48,353 @@ def to_hex_list(data):
     return "\n".join(out)
 
 
-for mod_file in glob.glob("mod/*.mod"):
-    with open(mod_file, "rb") as f:
-        data = f.read()
-        out = to_hex_list(data)
-        with open(mod_file + ".inc", "w") as f:
-            f.write(out)
+def get_channel_count(data):
+    return SUPPORTED_TAGS.get(bytes(data[SONG_HEADER_SIZE - 4 : SONG_HEADER_SIZE]), NUM_CHANNELS)
+
+
+def get_pattern_size(data):
+    return NUM_ROWS * get_channel_count(data) * 4
+
+
+def scan_song(data):
+    """Returns a bit mask of used opcodes and the highest used sample number."""
+    pattern_count = max(data[ORDERS_OFFSET : ORDERS_OFFSET + NUM_ORDERS]) + 1
+    cells = data[SONG_HEADER_SIZE : SONG_HEADER_SIZE + pattern_count * get_pattern_size(data)]
+
+    opcodes = 0
+    num_samples = 1
+
+    for i in range(0, len(cells) - 3, 4):
+        byte1, _, byte3, byte4 = cells[i : i + 4]
+        sample = (byte1 & 0xF0) | (byte3 >> 4)
+        effect = byte3 & 0xF
+
+        if 0 < sample <= NUM_SAMPLES:
+            num_samples = max(num_samples, sample)
+
+        if effect == 0xE:
+            opcodes |= 1 << (OPCODE_EXTENDED + (byte4 >> 4))
+        elif effect != 0 or byte4 != 0:
+            opcodes |= 1 << effect
+
+    return opcodes, num_samples
+
+
+def get_sample_length(data, sample):
+    header = SAMPLES_OFFSET + sample * SAMPLE_HEADER_SIZE
+    return int.from_bytes(data[header + 22 : header + 24], "big") * 2
+
+
+def get_cells(data, pattern, row):
+    channel_count = get_channel_count(data)
+    offset = SONG_HEADER_SIZE + (pattern * NUM_ROWS + row) * channel_count * 4
+    return [data[i : i + 4] for i in range(offset, offset + channel_count * 4, 4)]
+
+
+def find_reachable_rows(data):
+    """Returns the (order, row) pairs the playback can reach, following jumps, breaks and loops."""
+    song_length = data[SONG_LENGTH_OFFSET]
+    orders = data[ORDERS_OFFSET : ORDERS_OFFSET + song_length]
+    reachable = set()
+    pending = [(0, 0)]
+
+    while pending:
+        order, row = pending.pop()
+        if order >= song_length or row >= NUM_ROWS or (order, row) in reachable:
+            continue
+        reachable.add((order, row))
+
+        jump = None
+        break_row = None
+        for _, _, byte3, param in get_cells(data, orders[order], row):
+            effect = byte3 & 0xF
+            if effect == EFFECT_POSITION_JUMP:
+                jump = param
+            elif effect == EFFECT_PATTERN_BREAK:
+                break_row = (param >> 4) * 10 + (param & 0xF)
+            elif (effect << 4 | param >> 4) == EFFECT_PATTERN_LOOP and param & 0xF:
+                pending += [(order, loop_row) for loop_row in range(row)]
+
+        if jump is None and break_row is None:
+            if row + 1 < NUM_ROWS:
+                pending.append((order, row + 1))
+                continue
+            break_row = 0
+
+        next_order = order + 1 if jump is None else jump
+        pending.append((next_order % song_length if jump is None else next_order, break_row or 0))
+
+    return reachable
+
+
+def optimize_song(data):
+    """Returns the song without the data the playback never reaches:
+    patterns of the unreachable orders, unused samples, silence at the end of the one-shot samples
+    and the bytes after the sample data. Used samples are renumbered in order, so the song traits
+    get a lower NUM_SAMPLES. Seeking to an unreachable order plays another pattern then.
+    Tails after loop ends stay, the player plays them once, as ProTracker does.
+    The player clamps a sample offset past the end to it and plays the byte after the sample,
+    so that byte is kept for the samples an offset may reach, in an unused sample if the next one is dropped."""
+    song_length = data[SONG_LENGTH_OFFSET]
+    orders = data[ORDERS_OFFSET : ORDERS_OFFSET + NUM_ORDERS]
+    pattern_count = max(orders) + 1
+    reachable = find_reachable_rows(data)
+
+    used_samples = set()
+    max_offset = 0
+    for order, row in reachable:
+        for byte1, _, byte3, param in get_cells(data, orders[order], row):
+            sample = (byte1 & 0xF0) | (byte3 >> 4)
+            if 0 < sample <= NUM_SAMPLES:
+                used_samples.add(sample - 1)
+            if byte3 & 0xF == EFFECT_SAMPLE_OFFSET:
+                # 900 repeats the previous offset
+                max_offset = max(max_offset, param or 0xFF)
+
+    # ............................. Samples ...................................
+    sample_data = []
+    next_bytes = []
+    offset = SONG_HEADER_SIZE + pattern_count * get_pattern_size(data)
+    for i in range(NUM_SAMPLES):
+        length = get_sample_length(data, i)
+        # As the player loads them, empty samples and those past the end of the file take no data.
+        if length <= 2 or offset + length > len(data):
+            length = 0
+        sample_data.append(data[offset : offset + length])
+        offset += length
+        next_bytes.append(data[offset] if offset < len(data) else None)
+
+    sample_map = {}
+    headers = bytearray(NUM_SAMPLES * SAMPLE_HEADER_SIZE)
+    samples = bytearray()
+    samples_written = []
+    # The byte to follow the last written sample, if an offset may reach its end.
+    next_byte = None
+    for i in sorted(used_samples):
+        header = data[SAMPLES_OFFSET + i * SAMPLE_HEADER_SIZE : SAMPLES_OFFSET + (i + 1) * SAMPLE_HEADER_SIZE]
+        length = get_sample_length(data, i)
+        loop_end = int.from_bytes(header[26:28], "big") * 2 + int.from_bytes(header[28:30], "big") * 2
+        trimmed = len(sample_data[i])
+
+        # After the end, the player repeats the first byte of a one-shot sample.
+        # No sample offset may reach the end, the byte past it would play.
+        if loop_end <= 2 and trimmed > 2 and sample_data[i][0] == 0:
+            keep = max(max_offset * 256 + 1, 4)
+            while trimmed - 2 >= keep and sample_data[i][trimmed - 2 : trimmed] == b"\0\0":
+                trimmed -= 2
+
+        if trimmed != 0 and next_byte is not None and sample_data[i][0] != next_byte:
+            # The shortest non-empty sample, in the slot of a dropped one.
+            new_index = len(samples_written)
+            headers[new_index * SAMPLE_HEADER_SIZE + 22 : new_index * SAMPLE_HEADER_SIZE + 30] = bytes([0, 2, 0, 0, 0, 0, 0, 1])
+            samples += bytes([next_byte, 0, 0, 0])
+            samples_written.append(None)
+        if trimmed != 0:
+            next_byte = next_bytes[i] if trimmed == length and max_offset * 256 >= length else None
+
+        new_index = len(samples_written)
+        samples_written.append(i)
+        sample_map[i + 1] = new_index + 1
+        headers[new_index * SAMPLE_HEADER_SIZE : (new_index + 1) * SAMPLE_HEADER_SIZE] = header
+        headers[new_index * SAMPLE_HEADER_SIZE + 22 : new_index * SAMPLE_HEADER_SIZE + 24] = (trimmed // 2).to_bytes(2, "big")
+        samples += sample_data[i][:trimmed]
+
+    # The bytes after the sample data are not loaded.
+    if next_byte is not None:
+        samples.append(next_byte)
+
+    # ............................ Patterns ...................................
+    used_patterns = sorted({orders[order] for order, _ in reachable})
+    pattern_map = {pattern: i for i, pattern in enumerate(used_patterns)}
+    new_orders = bytes(pattern_map.get(orders[i], 0) if i < song_length else 0 for i in range(NUM_ORDERS))
+
+    patterns = bytearray()
+    for pattern in used_patterns:
+        for row in range(NUM_ROWS):
+            for byte1, byte2, byte3, byte4 in get_cells(data, pattern, row):
+                # The player ignores the numbers above NUM_SAMPLES
+                sample = (byte1 & 0xF0) | (byte3 >> 4)
+                sample = sample_map.get(sample, 0) if sample <= NUM_SAMPLES else sample
+                patterns += bytes([(sample & 0xF0) | (byte1 & 0xF), byte2, ((sample & 0xF) << 4) | (byte3 & 0xF), byte4])
+
+    out = bytearray(data[:SAMPLES_OFFSET]) + headers + data[SONG_LENGTH_OFFSET:ORDERS_OFFSET] + new_orders
+    out += data[ORDERS_OFFSET + NUM_ORDERS : SONG_HEADER_SIZE] + patterns + samples
+    return bytes(out)
+
+
+def to_s8(value):
+    return value - 256 if value >= 128 else value
+
+
+def make_delta4_table(samples):
+    """Returns 16 deltas fitted to the sample (Lloyd-Max on the deltas)."""
+    deltas = sorted(to_s8((b - a) & 0xFF) for a, b in zip(b"\0" + samples, samples))
+    table = [deltas[(2 * i + 1) * len(deltas) // (2 * DELTA4_TABLE_LENGTH)] for i in range(DELTA4_TABLE_LENGTH)]
+
+    for _ in range(16):
+        groups = [[] for _ in table]
+        for delta in deltas:
+            groups[min(range(len(table)), key=lambda i: abs(table[i] - delta))].append(delta)
+        table = [round(sum(g) / len(g)) if g else t for g, t in zip(groups, table)]
+
+    # The largest steps keep up with the fast changes.
+    table[table.index(min(table))] = deltas[0]
+    table[table.index(max(table))] = deltas[-1]
+    return table
+
+
+def encode_delta4(samples, next_byte):
+    """Returns the compressed sample data.
+    The player may read one sample past the end, it gets the byte after the uncompressed sample then."""
+    table = make_delta4_table(samples)
+    samples += bytes([next_byte])
+    seeds = bytearray()
+    codes = []
+    total = 0
+
+    for position, target in enumerate(samples):
+        if position % DELTA4_BLOCK_LENGTH == 0:
+            seeds.append(total)
+        code = min(range(DELTA4_TABLE_LENGTH), key=lambda i: abs(to_s8((total + table[i]) & 0xFF) - to_s8(target)))
+        total = (total + table[code]) & 0xFF
+        codes.append(code)
+
+    codes.append(0)
+    packed = bytes(codes[i] | (codes[i + 1] << 4) for i in range(0, len(samples), 2))
+    return DELTA4_SIGNATURE + bytes(d & 0xFF for d in table) + bytes(seeds) + packed
+
+
+def compress_samples(data):
+    """Returns the song with long samples compressed, the sample headers stay as they are."""
+    pattern_count = max(data[ORDERS_OFFSET : ORDERS_OFFSET + NUM_ORDERS]) + 1
+    offset = SONG_HEADER_SIZE + pattern_count * get_pattern_size(data)
+    out = bytearray(data[:offset])
+
+    for i in range(NUM_SAMPLES):
+        header = SAMPLES_OFFSET + i * SAMPLE_HEADER_SIZE
+        length = int.from_bytes(data[header + 22 : header + 24], "big") * 2
+        # As the player loads them, empty samples take no data.
+        if length <= 2:
+            continue
+        samples = data[offset : offset + length]
+        offset += length
+
+        if len(samples) == length >= DELTA4_MIN_LENGTH:
+            out += encode_delta4(samples, data[offset] if offset < len(data) else 0)
+        else:
+            out += samples
+
+    return bytes(out + data[offset:])
+
+
+def to_layout(name, data):
+    """Returns the initializer of mod8::format::SongLayout, made as Player::load() parses the song."""
+    if bytes(data[SONG_HEADER_SIZE - 4 : SONG_HEADER_SIZE]) not in SUPPORTED_TAGS:
+        raise ValueError(f"{name}: unsupported format")
+
+    pattern_count = max(data[ORDERS_OFFSET : ORDERS_OFFSET + NUM_ORDERS]) + 1
+    offset = SONG_HEADER_SIZE + pattern_count * get_pattern_size(data)
+    samples = []
+
+    for i in range(NUM_SAMPLES):
+        header = data[SAMPLES_OFFSET + i * SAMPLE_HEADER_SIZE : SAMPLES_OFFSET + (i + 1) * SAMPLE_HEADER_SIZE]
+        length = int.from_bytes(header[22:24], "big") * 2 & 0xFFFF
+        finetune = min(header[24], MAX_FINETUNE)
+        volume = min(header[25], MAX_VOLUME)
+        compressed = length > 2 and data[offset : offset + len(DELTA4_SIGNATURE)] == DELTA4_SIGNATURE
+        stored = len(DELTA4_SIGNATURE) + DELTA4_TABLE_LENGTH + length // DELTA4_BLOCK_LENGTH + 1 + length // 2 + 1
+        stored = stored if compressed else length
+
+        if length <= 2 or offset + stored > len(data):
+            samples.append(f"    {{ {offset}UL, 0, 0, 0, 0, {volume}, 0, 0 }},")
+            continue
+
+        begin = offset + (len(DELTA4_SIGNATURE) if compressed else 0)
+        limit = length if compressed else len(data) - begin
+        loop_start = int.from_bytes(header[26:28], "big") * 2 & 0xFFFF
+        loop_length = int.from_bytes(header[28:30], "big") * 2 & 0xFFFF
+        if loop_start > limit or loop_start + loop_length > limit:
+            raise ValueError(f"{name}: sample {i + 1} loop is out of the sample data")
+
+        loop_delta_sum = 0
+        if compressed:
+            codes = begin + DELTA4_TABLE_LENGTH + length // DELTA4_BLOCK_LENGTH + 1
+            block = loop_start // DELTA4_BLOCK_LENGTH
+            loop_delta_sum = data[begin + DELTA4_TABLE_LENGTH + block]
+            for position in range(block * DELTA4_BLOCK_LENGTH, loop_start):
+                code = data[codes + position // 2] >> (4 * (position % 2)) & 0xF
+                loop_delta_sum = (loop_delta_sum + data[begin + code]) & 0xFF
+
+        samples.append(
+            f"    {{ {begin}UL, {length}, {loop_start}, {loop_length}, {finetune}, {volume}, "
+            f"{int(compressed)}, {loop_delta_sum} }},"
+        )
+        offset += stored
+
+    out = [
+        f"// Layout of {name}, see mod8::format::SongLayout.",
+        "{",
+        f"  {data[SONG_LENGTH_OFFSET]}, {pattern_count},",
+        "  {",
+    ]
+    out += samples
+    out += ["  }", "}", ""]
+    return "\n".join(out)
+
+
+def to_traits(name, data):
+    opcodes, num_samples = scan_song(data)
+    identifier = re.sub(r"\W", "_", name)
+    if identifier[0].isdigit():
+        identifier = "song_" + identifier
+    channel_count = get_channel_count(data)
+    out = [f"// Features of {name}, see mod8::DefaultSongTraits."]
+    if channel_count != NUM_CHANNELS:
+        out.append(f"// The song has {channel_count} channels, play it with mod8::BasicPlayer<{identifier}_traits, {channel_count}>.")
+    out += [
+        f"struct {identifier}_traits {{",
+        f"  static constexpr uint32_t OPCODES = 0x{opcodes:08x}UL;",
+        f"  static constexpr uint8_t NUM_SAMPLES = {num_samples};",
+        "};",
+        "",
+    ]
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Converts mod/*.mod files to *.inc files.")
+    parser.add_argument(
+        "--optimize",
+        action="store_true",
+        help="drop the patterns and samples the playback never reaches",
+    )
+    parser.add_argument(
+        "--layout",
+        action="store_true",
+        help="also write *.layout.inc files for the faster Player::load()",
+    )
+    parser.add_argument(
+        "--delta4",
+        action="store_true",
+        help="compress long samples to 4 bits per sample, requires MOD8_OPTION_COMPRESSED_SAMPLES",
+    )
+    args = parser.parse_args()
+
+    for mod_file in glob.glob("mod/*.mod"):
+        with open(mod_file, "rb") as f:
+            data = f.read()
+            if args.optimize:
+                data = optimize_song(data)
+            if args.delta4:
+                data = compress_samples(data)
+            with open(mod_file + ".inc", "w") as f:
+                f.write(to_hex_list(data))
+            if args.layout:
+                with open(mod_file + ".layout.inc", "w") as f:
+                    f.write(to_layout(os.path.basename(mod_file), data))
+            with open(mod_file + ".traits.inc", "w") as f:
+                f.write(to_traits(os.path.basename(mod_file), data))
+
+
+if __name__ == "__main__":
+    main()
@@ -27,6 +27,7 @@
 #include "Format.hpp"
 #include "Math.hpp"
 #include "Sampler.hpp"
+#include "SongTraits.hpp"
 
 namespace mod8 {
 
@@ -67,15 +68,19 @@ constexpr uint8_t SINE_TABLE[SINE_TABLE_LENGTH] MOD8_ATTR_CONST_ARRAY{
 }  // namespace internal
 
 ////////////////////////////////////////////////////////////////////////////////
-class Channel {
+/// @brief Channel of the song.
+/// @tparam Traits features of the song, see DefaultSongTraits.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Traits>
+class BasicChannel {
 public:
   //////////////////////////////////////////////////////////////////////////////
-  Channel() = default;
-  ~Channel() = default;
-  Channel(const Channel &) = delete;
-  Channel &operator=(const Channel &) = delete;
-  Channel(Channel &&) = delete;
-  Channel &operator=(Channel &&) = delete;
+  BasicChannel() = default;
+  ~BasicChannel() = default;
+  BasicChannel(const BasicChannel &) = delete;
+  BasicChannel &operator=(const BasicChannel &) = delete;
+  BasicChannel(BasicChannel &&) = delete;
+  BasicChannel &operator=(BasicChannel &&) = delete;
 
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE void fetch_sample() /* called from interrupt */ {
@@ -87,6 +92,11 @@ public:
     return m_sampler;
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE Sampler &sampler() {
+    return m_sampler;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   void init() {
     m_sampler.init();
@@ -142,9 +152,10 @@ public:
   }
 
   //////////////////////////////////////////////////////////////////////////////
+  // The sample is copied with MOD8_OPTION_SMALL_RAM.
   void set_sample(const Sample *sample) {
     if (sample != nullptr) {
-      m_input.sample = sample;
+      internal_assign(m_input.sample, sample);
       m_tick_state.actions |= ACTION_LOAD_SAMPLE;
     }
   }
@@ -354,6 +365,23 @@ public:
   }
 
 private:
+  // ---------------------------------------------------------------------------
+  // Tick effects of the song.
+  static constexpr bool USES_ARPEGGIO = song_uses<Traits>(opcode_bit(OPCODE_ARPEGGIO));
+  static constexpr bool USES_VOLUME_SLIDE = song_uses<Traits>(
+    opcode_bit(OPCODE_VOLUME_SLIDE) | opcode_bit(OPCODE_PORTA_VOLUME_SLIDE)
+    | opcode_bit(OPCODE_VIBRATO_VOLUME_SLIDE));
+  static constexpr bool USES_TREMOLO = song_uses<Traits>(opcode_bit(OPCODE_TREMOLO));
+  static constexpr bool USES_PORTA_UP = song_uses<Traits>(opcode_bit(OPCODE_PORTA_UP));
+  static constexpr bool USES_PORTA_DOWN = song_uses<Traits>(opcode_bit(OPCODE_PORTA_DOWN));
+  static constexpr bool USES_PORTA_TO_NOTE = song_uses<Traits>(
+    opcode_bit(OPCODE_PORTA_TO_NOTE) | opcode_bit(OPCODE_PORTA_VOLUME_SLIDE));
+  static constexpr bool USES_VIBRATO = song_uses<Traits>(
+    opcode_bit(OPCODE_VIBRATO) | opcode_bit(OPCODE_VIBRATO_VOLUME_SLIDE));
+  static constexpr bool USES_RETRIG_NOTE = song_uses<Traits>(opcode_bit(OPCODE_RETRIG_NOTE));
+  static constexpr bool USES_NOTE_CUT = song_uses<Traits>(opcode_bit(OPCODE_NOTE_CUT));
+  static constexpr bool USES_NOTE_DELAY = song_uses<Traits>(opcode_bit(OPCODE_NOTE_DELAY));
+
   // ---------------------------------------------------------------------------
   void internal_update_volume() {
     using math::u8_to_s8;
@@ -361,6 +389,10 @@ private:
 
     switch (m_row_effects.volume_effect) {
       case VOLUME_EFFECT_DEC:
+        if (!USES_VOLUME_SLIDE) {
+          break;
+        }
+
         if (u8_to_s8(m_row_effects.volume_param) > m_state.volume) {
           m_state.volume = 0;
         } else {
@@ -372,6 +404,10 @@ private:
         break;
 
       case VOLUME_EFFECT_INC:
+        if (!USES_VOLUME_SLIDE) {
+          break;
+        }
+
         if (u8_to_s8(m_row_effects.volume_param) > format::MAX_VOLUME - m_state.volume) {
           m_state.volume = format::MAX_VOLUME;
         } else {
@@ -383,6 +419,10 @@ private:
         break;
 
       case VOLUME_EFFECT_TREMOLO:
+        if (!USES_TREMOLO) {
+          break;
+        }
+
         {
           // abs value
           const auto index = static_cast<uint8_t>(
@@ -424,6 +464,10 @@ private:
   void internal_update_note() {
     switch (m_row_effects.note_effect) {
       case NOTE_EFFECT_CUT:
+        if (!USES_NOTE_CUT) {
+          break;
+        }
+
         if (m_row_state.tick_counter == m_row_effects.note_param) {
           m_state.volume = 0;
           m_tick_state.volume = 0;
@@ -434,6 +478,10 @@ private:
         break;
 
       case NOTE_EFFECT_DELAY:
+        if (!USES_NOTE_DELAY) {
+          break;
+        }
+
         if (m_row_state.tick_counter == m_row_effects.note_param) {
           m_tick_state.actions |= m_row_state.delayed_actions;
           m_row_effects.reset();
@@ -442,6 +490,10 @@ private:
         break;
 
       case NOTE_EFFECT_REPEAT:
+        if (!USES_RETRIG_NOTE) {
+          break;
+        }
+
         if (m_row_state.tick_counter % m_row_effects.note_param == 0) {
           m_tick_state.actions |= ACTION_RETRIG;
         }
@@ -457,6 +509,10 @@ private:
 
     switch (m_row_effects.period_effect) {
       case PERIOD_EFFECT_PORTAMENTO:
+        if (!USES_PORTA_TO_NOTE) {
+          break;
+        }
+
         if (m_input.period != 0) {
           if (m_state.period > m_input.period) {
             if (m_state.period >= m_input.portamento_slide) {
@@ -488,6 +544,10 @@ private:
         break;
 
       case PERIOD_EFFECT_DEC:
+        if (!USES_PORTA_UP) {
+          break;
+        }
+
         if (m_state.period >= m_row_effects.period_param) {
           m_state.period -= m_row_effects.period_param;
         } else {
@@ -503,6 +563,10 @@ private:
         break;
 
       case PERIOD_EFFECT_INC:
+        if (!USES_PORTA_DOWN) {
+          break;
+        }
+
         if (m_state.period < format::MAX_PERIOD) {
           m_state.period += m_row_effects.period_param;
         } else {
@@ -514,6 +578,10 @@ private:
         break;
 
       case PERIOD_EFFECT_VIBRATO:
+        if (!USES_VIBRATO) {
+          break;
+        }
+
         {
           // abs value
           const auto index = static_cast<uint8_t>(
@@ -542,17 +610,41 @@ private:
       case PERIOD_EFFECT_NONE: break;
     }
 
-    if (m_row_effects.arpeggio_effect == ARPEGGIO_EFFECT_ARPEGGIO) {
+    if (USES_ARPEGGIO && m_row_effects.arpeggio_effect == ARPEGGIO_EFFECT_ARPEGGIO) {
       m_tick_state.actions |= ACTION_UPDATE_PERIOD;
       m_tick_state.actions |= ACTION_USE_ARPEGGIO;
     }
   }
 
+  // ---------------------------------------------------------------------------
+  // The player reads the sample descriptors lazily with MOD8_OPTION_SMALL_RAM, so the channel keeps copies.
+#if MOD8_OPTION_SMALL_RAM
+  using SampleSlot = Sample;
+#else
+  using SampleSlot = const Sample *;
+#endif
+
+  MOD8_ATTR_INLINE static void internal_assign(const Sample *&slot, const Sample *sample) {
+    slot = sample;
+  }
+
+  MOD8_ATTR_INLINE static void internal_assign(Sample &slot, const Sample *sample) {
+    slot = *sample;
+  }
+
+  MOD8_ATTR_INLINE static const Sample *internal_deref(const Sample *slot) {
+    return slot;
+  }
+
+  MOD8_ATTR_INLINE static const Sample *internal_deref(const Sample &slot) {
+    return &slot;
+  }
+
   // ---------------------------------------------------------------------------
   void internal_load_sample() {
     if (m_tick_state.actions & ACTION_LOAD_SAMPLE) {
       m_state.sample = m_input.sample;
-      m_state.volume = m_input.sample->volume;
+      m_state.volume = internal_deref(m_input.sample)->volume;
       m_tick_state.volume = m_state.volume;
       m_tick_state.actions &= ~ACTION_LOAD_SAMPLE;
       m_tick_state.actions |= ACTION_UPDATE_VOLUME;
@@ -572,9 +664,9 @@ private:
 
       if (m_tick_state.actions & ACTION_USE_SAMPLE_OFFSET) {
         m_sampler.retrig(
-          m_state.sample, m_state.period, m_input.sample_offset, m_state.volume);
+          internal_deref(m_state.sample), m_state.period, m_input.sample_offset, m_state.volume);
       } else {
-        m_sampler.retrig(m_state.sample, m_state.period, 0, m_state.volume);
+        m_sampler.retrig(internal_deref(m_state.sample), m_state.period, 0, m_state.volume);
       }
     } else {
       if (m_tick_state.actions & ACTION_UPDATE_VOLUME) {
@@ -582,7 +674,7 @@ private:
       }
 
       if (m_tick_state.actions & ACTION_UPDATE_PERIOD) {
-        if (m_tick_state.actions & ACTION_USE_ARPEGGIO) {
+        if (USES_ARPEGGIO && (m_tick_state.actions & ACTION_USE_ARPEGGIO)) {
           const uint8_t arpeggio_shift = m_row_effects
                                            .arpeggio_params[m_row_state.tick_counter % format::ARPEGGIO_PERIOD];
 
@@ -659,15 +751,16 @@ private:
     NOTE_EFFECT_DELAY = 3U
   };
 
+  // The bit fields of MOD8_OPTION_SMALL_RAM are grouped by bytes.
   struct {
-    ArpeggioEffect arpeggio_effect;                    // ∈ {ArpeggioEffect}
-    uint8_t arpeggio_params[format::ARPEGGIO_PERIOD];  // ∈ [0; 15]
-    VolumeEffect volume_effect;                        // ∈ {VolumeEffect}
-    uint8_t volume_param;                              // ∈ [0; 15]
-    PeriodEffect period_effect;                        // ∈ {PeriodEffect}
-    uint8_t period_param;                              // ∈ [0; 255]
-    NoteEffect note_effect;                            // ∈ {NoteEffect}
-    uint8_t note_param;                                // ∈ [0; 15]
+    ArpeggioEffect arpeggio_effect MOD8_INTERNAL_BITS(1);  // ∈ {ArpeggioEffect}
+    VolumeEffect volume_effect MOD8_INTERNAL_BITS(2);      // ∈ {VolumeEffect}
+    PeriodEffect period_effect MOD8_INTERNAL_BITS(3);      // ∈ {PeriodEffect}
+    NoteEffect note_effect MOD8_INTERNAL_BITS(2);          // ∈ {NoteEffect}
+    uint8_t volume_param MOD8_INTERNAL_BITS(4);            // ∈ [0; 15]
+    uint8_t note_param MOD8_INTERNAL_BITS(4);              // ∈ [0; 15]
+    uint8_t period_param;                                  // ∈ [0; 255]
+    uint8_t arpeggio_params[format::ARPEGGIO_PERIOD];      // ∈ [0; 15]
 
     void reset() {
       arpeggio_effect = ARPEGGIO_EFFECT_NONE;
@@ -678,23 +771,26 @@ private:
   } m_row_effects;
 
   struct {
-    const Sample *sample;  //
-    uint16_t period;       // ∈ [MIN_PERIOD; MAX_PERIOD]
-    int8_t volume;         // ∈ [0; MAX_VOLUME]
-    int8_t vibrato_pos;    // ∈ [-32; 31]
-    int8_t tremolo_pos;    // ∈ [-32; 31]
+    SampleSlot sample;  //
+    uint16_t period;    // ∈ [MIN_PERIOD; MAX_PERIOD]
+    int8_t volume;       // ∈ [0; MAX_VOLUME]
+    int8_t vibrato_pos;  // ∈ [-32; 31]
+    int8_t tremolo_pos;  // ∈ [-32; 31]
   } m_state;
 
   struct {
-    const Sample *sample;
-    uint16_t period;           // ∈ [MIN_PERIOD; MAX_PERIOD]
-    uint8_t portamento_slide;  // ∈ [0; 255]
-    uint8_t vibrato_speed;     // ∈ [0; 15]
-    uint8_t vibrato_depth;     // ∈ [0; 15]
-    uint8_t tremolo_speed;     // ∈ [0; 15]
-    uint8_t tremolo_depth;     // ∈ [0; 15]
-    uint8_t sample_offset;     // ∈ [0; 255]
+    SampleSlot sample;
+    uint16_t period;                              // ∈ [MIN_PERIOD; MAX_PERIOD]
+    uint8_t portamento_slide;                     // ∈ [0; 255]
+    uint8_t vibrato_speed MOD8_INTERNAL_BITS(4);  // ∈ [0; 15]
+    uint8_t vibrato_depth MOD8_INTERNAL_BITS(4);  // ∈ [0; 15]
+    uint8_t tremolo_speed MOD8_INTERNAL_BITS(4);  // ∈ [0; 15]
+    uint8_t tremolo_depth MOD8_INTERNAL_BITS(4);  // ∈ [0; 15]
+    uint8_t sample_offset;                        // ∈ [0; 255]
   } m_input;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+using Channel = BasicChannel<DefaultSongTraits>;
+
 }  // namespace mod8
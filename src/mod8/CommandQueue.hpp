@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+#include "Sampler.hpp"
+
+#if MOD8_OPTION_COMMAND_QUEUE
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Single-producer, single-consumer ring of sampler changes from update() to the interrupt.
+/// The changes of a player tick are published at once, so the interrupt applies them
+/// between two frames, and update() never waits for the interrupt.
+/// @tparam NUM_CHANNELS number of channels, at most one command per channel is published per tick.
+////////////////////////////////////////////////////////////////////////////////
+template <uint8_t NUM_CHANNELS>
+class CommandQueue {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  struct Entry {
+    uint8_t channel;
+    Sampler::Command command;
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Drop all commands. Call only when the interrupt doesn't mix.
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    m_read = m_write = m_pending = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Whether all published commands were applied.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool is_empty() const /* called from interrupt */ {
+    return m_read == m_write;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Add the command, invisible to the interrupt until publish().
+  /// @note Push only into the empty queue, at most NUM_CHANNELS commands.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void push(uint8_t channel, const Sampler::Command &command) {
+    Entry &entry = m_entries[m_pending & MASK];
+    entry.channel = channel;
+    entry.command = command;
+    ++m_pending;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Make the pushed commands visible to the interrupt.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void publish() {
+    // Publish the commands only after they were written.
+    memory::barrier();
+    m_write = m_pending;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Oldest published command.
+  /// @note Call only if the queue isn't empty.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE const Entry &front() const /* called from interrupt */ {
+    return m_entries[m_read & MASK];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void pop() /* called from interrupt */ {
+    m_read = m_read + 1U;
+  }
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  // Indices are free-running.
+  static constexpr uint8_t LENGTH = NUM_CHANNELS <= 4 ? 4 : 8;
+  static constexpr uint8_t MASK = LENGTH - 1U;
+
+  static_assert(NUM_CHANNELS <= LENGTH, "Command queue is too short");
+
+  Entry m_entries[LENGTH];
+  volatile uint8_t m_read /* written from interrupt */;
+  volatile uint8_t m_write /* read from interrupt */;
+  uint8_t m_pending;
+};
+
+}  // namespace mod8
+
+#endif  // MOD8_OPTION_COMMAND_QUEUE
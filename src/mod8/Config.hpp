@@ -29,6 +29,7 @@
 #include <Arduino.h>
 static_assert(sizeof(size_t) == 2, "Unexpected type size");
 #else  // defined(ARDUINO)
+#include <atomic>
 #include <cstdint>
 #include <cstring>
 #endif  // defined(ARDUINO)
@@ -46,7 +47,7 @@ static_assert(sizeof(long) == sizeof(uint32_t), "Unexpected type size");
 
 #if !defined(MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2)
 /// @brief Binary logarithm of downsamling factor.
-/// Values 0 or 1 are OK.
+/// Values 0 to 3 are OK. The voices are fetched in turn, one in DOWNSAMPLING_FACTOR per mixing call.
 #define MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 0
 #endif
 
@@ -70,11 +71,211 @@ static_assert(sizeof(long) == sizeof(uint32_t), "Unexpected type size");
 #define MOD8_OPTION_AMIGA_PERIODS false
 #endif
 
+#if !defined(MOD8_OPTION_PERIOD_RECIPROCAL_TABLE)
+/// @brief Whether to replace the division in period-to-speed conversion with a table lookup.
+/// Costs ~1.5KiB of flash memory.
+#define MOD8_OPTION_PERIOD_RECIPROCAL_TABLE true
+#endif
+
+#if !defined(MOD8_OPTION_ASM_MIXER)
+/// @brief Whether to use the hand-written assembly version of the sample fetching on AVR.
+/// Must produce exactly the same output as the C++ version, checked by the SAME (ASM) tests under simavr.
+#define MOD8_OPTION_ASM_MIXER false
+#endif
+
+#if !defined(MOD8_OPTION_PROFILING)
+/// @brief If enabled, the player measures its hot paths and reports the costs in Player::Stats.
+/// The user application must define mod8::profiling::read_clock().
+#define MOD8_OPTION_PROFILING false
+#endif
+
+#if !defined(MOD8_OPTION_SIMD_MIXER)
+/// @brief Whether render() mixes the frames between player ticks in blocks, with all voices at once.
+/// Produces exactly the same output as the per-frame mixing.
+/// Ignored on AVR, with downsampling, MOD8_OPTION_EXTERNAL_STORAGE, MOD8_OPTION_COMPRESSED_SAMPLES,
+/// MOD8_OPTION_INTERPOLATION and sound effect voices.
+#define MOD8_OPTION_SIMD_MIXER true
+#endif
+
+#if !defined(MOD8_OPTION_PATTERN_CACHE)
+/// @brief If enabled, the player decodes the playing and the next pattern during idle update() calls.
+/// Flattens the update() spikes at row boundaries. Costs 2.5KiB of RAM.
+#define MOD8_OPTION_PATTERN_CACHE false
+#endif
+
+#if !defined(MOD8_OPTION_CHECKPOINTS)
+/// @brief If enabled, scan_duration() can store the player state at order boundaries
+/// into a user table, and seek() fast-forwards from the nearest one.
+/// The scan then advances the samplers up to the last checkpoint; with MOD8_OPTION_DOWNSAMPLING_WITH_LERP,
+/// it mixes every downsampled frame too, because the interpolated output depends on all the previous ones.
+#define MOD8_OPTION_CHECKPOINTS false
+#endif
+
+#if !defined(MOD8_OPTION_FAR_PROGMEM)
+/// @brief If enabled, the song may be larger than 64 KiB on AVR with ELPM, e.g. ATmega1284P or ATmega2560.
+/// The song header and the patterns must lie in the first 64 KiB of flash, the sample data anywhere.
+/// Costs 4 more bytes of RAM per channel and 8 per sample. The far reads make the interrupt slower,
+/// by an amount not measured yet.
+#define MOD8_OPTION_FAR_PROGMEM false
+#endif
+
 #if !defined(MOD8_OPTION_STOP_ON_F00_CMD)
 /// @brief If enabled, the F00 command stops playback.
 #define MOD8_OPTION_STOP_ON_F00_CMD false
 #endif
 
+#if !defined(MOD8_OPTION_BUFFERED_OUTPUT)
+/// @brief If enabled, update() mixes ahead into a ring buffer and tick() only pops mixed frames.
+/// Keeps the interrupt routine short at the cost of some RAM and output latency.
+#define MOD8_OPTION_BUFFERED_OUTPUT false
+#endif
+
+#if !defined(MOD8_PARAM_OUTPUT_BUFFER_LENGTH_LOG2)
+/// @brief Binary logarithm of the output ring buffer length (in frames).
+/// Values 5..7 are OK.
+#define MOD8_PARAM_OUTPUT_BUFFER_LENGTH_LOG2 6
+#endif
+
+#if !defined(MOD8_OPTION_EXTERNAL_STORAGE)
+/// @brief If enabled, the song is read from external storage, e.g. SPI flash or SD card,
+/// with mod8::storage::read() defined by the user application. The song size is not limited by flash.
+/// Sample data is read in blocks into the read-ahead buffer of each channel, pattern rows one row ahead.
+/// Requires MOD8_OPTION_BUFFERED_OUTPUT on AVR, so that nothing is read from the interrupt.
+#define MOD8_OPTION_EXTERNAL_STORAGE false
+#endif
+
+#if !defined(MOD8_PARAM_READ_AHEAD_LENGTH)
+/// @brief Length of the sample read-ahead buffer of each channel (in bytes).
+/// Used with MOD8_OPTION_EXTERNAL_STORAGE only. Values 16..128 are OK.
+#define MOD8_PARAM_READ_AHEAD_LENGTH 32
+#endif
+
+#if !defined(MOD8_OPTION_COMPRESSED_SAMPLES)
+/// @brief If enabled, the player also plays sample data compressed to 4 bits per sample,
+/// see format::DELTA4_SIGNATURE and `mod-to-inc.py --delta4`. Uncompressed samples play as usual.
+/// Costs 9 more bytes of RAM per channel and 2 per sample. The decoding makes the interrupt slower,
+/// by an amount not measured yet.
+#define MOD8_OPTION_COMPRESSED_SAMPLES false
+#endif
+
+#if !defined(MOD8_OPTION_COMMAND_QUEUE)
+/// @brief If enabled, update() passes the sampler changes of a player tick to the interrupt
+/// through a lock-free queue, and the interrupt applies them all between two frames.
+/// So the notes of a row start on the same frame, and update() never waits for the interrupt.
+/// Costs ~80 more clocks per retriggered voice in the interrupt and 7 more bytes of RAM per channel,
+/// plus 8 per queue entry.
+#define MOD8_OPTION_COMMAND_QUEUE false
+#endif
+
+#if !defined(MOD8_PARAM_SFX_VOICES)
+/// @brief Number of sound effect voices mixed on top of the music, see Player::trigger_sfx().
+/// Values 0..2 are OK. Costs ~90 clocks per playing voice and ~20 for the clipping in the interrupt,
+/// and ~40 bytes of RAM per voice.
+#define MOD8_PARAM_SFX_VOICES 0
+#endif
+
+#if !defined(MOD8_OPTION_INCREMENTAL_UPDATE)
+/// @brief If enabled, update() does a player tick in bounded steps, one per call:
+/// moving to the next row, playing one note of the row, ticking one channel, passing the changes on.
+/// update() returns PARTIAL until the tick is complete, see Player::get_remaining_steps().
+/// With MOD8_OPTION_PATTERN_CACHE, the rows are also decoded in advance, so no step decodes a row.
+/// With MOD8_OPTION_COMMAND_QUEUE, all sampler changes of the tick still start on the same frame.
+#define MOD8_OPTION_INCREMENTAL_UPDATE false
+#endif
+
+#if !defined(MOD8_OPTION_EVENT_QUEUE)
+/// @brief If enabled, the player records the fetched rows and notes into a lock-free queue,
+/// and the application drains it at its own pace with Player::poll_event(),
+/// e.g. for visualisers, VU meters or beat sync. Unlike MOD8_OPTION_PLAYER_EVENTS callbacks,
+/// a slow consumer never delays update(), the events that don't fit are counted and dropped.
+/// Costs ~40 clocks per recorded event in update() and 11 bytes of RAM per queue entry.
+#define MOD8_OPTION_EVENT_QUEUE false
+#endif
+
+#if !defined(MOD8_PARAM_EVENT_QUEUE_LENGTH_LOG2)
+/// @brief Binary logarithm of the event queue length (in events).
+/// Values 2..7 are OK. A row takes up to NUM_CHANNELS + 1 events.
+#define MOD8_PARAM_EVENT_QUEUE_LENGTH_LOG2 4
+#endif
+
+#if !defined(MOD8_OPTION_SMALL_RAM)
+/// @brief If enabled, the player keeps less in RAM, for AVRs with 512 bytes to 1 KiB of SRAM:
+/// the sample descriptors aren't kept, but read again from the song header or from the layout
+/// for each note, the song name and the format tag aren't copied into Song, the effect state
+/// of the channels is packed into bit fields. Use with the song traits made by `mod-to-inc.py --optimize`,
+/// which renumbers the used samples, so only they take RAM.
+/// Saves 8 bytes per sample less 2 for its data offset, and 36 bytes of Song, but costs 10 more bytes
+/// per channel and a parse of the sample header per note with a sample number in update().
+#define MOD8_OPTION_SMALL_RAM false
+#endif
+
+#if !defined(MOD8_OPTION_INTERPOLATION)
+/// @brief If enabled, the samplers interpolate linearly between the sample byte at the playback position
+/// and the next one instead of repeating the byte, which suppresses the resampling noise of the offline
+/// renders at 44.1 or 48 kHz. Changes the output, so the checksums of the test songs don't match.
+/// Ignored on AVR. Costs a second read of the sample data and a multiplication per fetched sample.
+#define MOD8_OPTION_INTERPOLATION false
+#endif
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && MOD8_OPTION_FAR_PROGMEM
+#error "MOD8_OPTION_EXTERNAL_STORAGE and MOD8_OPTION_FAR_PROGMEM are mutually exclusive"
+#endif
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && MOD8_OPTION_ASM_MIXER
+#error "MOD8_OPTION_ASM_MIXER doesn't support MOD8_OPTION_EXTERNAL_STORAGE"
+#endif
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES && (MOD8_OPTION_ASM_MIXER || MOD8_OPTION_EXTERNAL_STORAGE)
+#error "MOD8_OPTION_COMPRESSED_SAMPLES doesn't support MOD8_OPTION_ASM_MIXER and MOD8_OPTION_EXTERNAL_STORAGE"
+#endif
+
+#if MOD8_OPTION_COMMAND_QUEUE && MOD8_OPTION_COMPRESSED_SAMPLES
+#error "MOD8_OPTION_COMMAND_QUEUE doesn't support MOD8_OPTION_COMPRESSED_SAMPLES, the seek in the sample is too slow"
+#endif
+
+#if MOD8_OPTION_SMALL_RAM && (MOD8_OPTION_FAR_PROGMEM || MOD8_OPTION_EXTERNAL_STORAGE)
+#error "MOD8_OPTION_SMALL_RAM doesn't support MOD8_OPTION_FAR_PROGMEM and MOD8_OPTION_EXTERNAL_STORAGE"
+#endif
+
+#if MOD8_OPTION_SMALL_RAM && (MOD8_OPTION_COMPRESSED_SAMPLES || MOD8_OPTION_COMMAND_QUEUE)
+#error "MOD8_OPTION_SMALL_RAM doesn't support MOD8_OPTION_COMPRESSED_SAMPLES and MOD8_OPTION_COMMAND_QUEUE"
+#endif
+
+#if MOD8_OPTION_INTERPOLATION && (MOD8_OPTION_COMPRESSED_SAMPLES || MOD8_OPTION_EXTERNAL_STORAGE)
+#error "MOD8_OPTION_INTERPOLATION doesn't support MOD8_OPTION_COMPRESSED_SAMPLES and MOD8_OPTION_EXTERNAL_STORAGE"
+#endif
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && defined(ARDUINO_ARCH_AVR) && !MOD8_OPTION_BUFFERED_OUTPUT
+#error "MOD8_OPTION_EXTERNAL_STORAGE requires MOD8_OPTION_BUFFERED_OUTPUT"
+#endif
+
+/// @brief Whether sample data may lie beyond 64 KiB on AVR.
+#define MOD8_INTERNAL_FAR_SAMPLES (MOD8_OPTION_FAR_PROGMEM || MOD8_OPTION_EXTERNAL_STORAGE)
+/// @brief Whether sample positions are offsets from the address of the sample on AVR.
+#define MOD8_INTERNAL_SAMPLE_OFFSETS (MOD8_INTERNAL_FAR_SAMPLES || MOD8_OPTION_COMPRESSED_SAMPLES)
+
+/// @brief Whether the type may be copied with memcpy(). There is no <type_traits> on AVR.
+#define MOD8_INTERNAL_IS_TRIVIALLY_COPYABLE(type) __is_trivially_copyable(type)
+
+/// @brief Whether the output is interpolated between the downsampled frames.
+#define MOD8_INTERNAL_LERP (MOD8_OPTION_DOWNSAMPLING_WITH_LERP && MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0)
+
+/// @brief Width of a bit field that MOD8_OPTION_SMALL_RAM packs: `uint8_t param MOD8_INTERNAL_BITS(4);`
+#if MOD8_OPTION_SMALL_RAM
+#define MOD8_INTERNAL_BITS(width) : width
+#else
+#define MOD8_INTERNAL_BITS(width)
+#endif
+
+/// @brief Whether render() uses the block mixer, which reads the uncompressed sample data directly.
+#if MOD8_OPTION_SIMD_MIXER && MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 0 \
+  && !MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_COMPRESSED_SAMPLES && MOD8_PARAM_SFX_VOICES == 0 \
+  && !MOD8_OPTION_INTERPOLATION
+#define MOD8_INTERNAL_SIMD_MIXER true
+#else
+#define MOD8_INTERNAL_SIMD_MIXER false
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Misc. attributes of functions and variables.
 ////////////////////////////////////////////////////////////////////////////////
@@ -118,7 +319,31 @@ constexpr uint8_t VOLUME_ATTENNUATION_LOG2 = MOD8_PARAM_VOLUME_ATTENUATION_LOG2;
 /// @brief Downsapling factor.
 constexpr int8_t DOWNSAMPLING_FACTOR = 1 << MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2;
 
-static_assert(DOWNSAMPLING_FACTOR >= 1 && DOWNSAMPLING_FACTOR <= 2, "Unsupported downsampling factor");
+static_assert(DOWNSAMPLING_FACTOR >= 1 && DOWNSAMPLING_FACTOR <= 8, "Unsupported downsampling factor");
+
+/// @brief Number of sound effect voices.
+constexpr uint8_t SFX_VOICES = MOD8_PARAM_SFX_VOICES;
+
+static_assert(SFX_VOICES <= 2, "Unsupported number of sound effect voices");
+
+/// @brief Length of the output ring buffer (in frames).
+constexpr uint8_t OUTPUT_BUFFER_LENGTH = 1U << MOD8_PARAM_OUTPUT_BUFFER_LENGTH_LOG2;
+constexpr uint8_t OUTPUT_BUFFER_MASK = OUTPUT_BUFFER_LENGTH - 1U;
+
+static_assert(MOD8_PARAM_OUTPUT_BUFFER_LENGTH_LOG2 >= 1 && MOD8_PARAM_OUTPUT_BUFFER_LENGTH_LOG2 <= 7,
+              "Unsupported output buffer length");
+
+/// @brief Length of the event queue (in events).
+constexpr uint8_t EVENT_QUEUE_LENGTH = 1U << MOD8_PARAM_EVENT_QUEUE_LENGTH_LOG2;
+constexpr uint8_t EVENT_QUEUE_MASK = EVENT_QUEUE_LENGTH - 1U;
+
+static_assert(MOD8_PARAM_EVENT_QUEUE_LENGTH_LOG2 >= 2 && MOD8_PARAM_EVENT_QUEUE_LENGTH_LOG2 <= 7,
+              "Unsupported event queue length");
+
+/// @brief Length of the sample read-ahead buffer (in bytes).
+constexpr uint8_t READ_AHEAD_LENGTH = MOD8_PARAM_READ_AHEAD_LENGTH;
+
+static_assert(READ_AHEAD_LENGTH >= 16 && READ_AHEAD_LENGTH <= 128, "Unsupported read-ahead length");
 
 /// @brief Amiga Paula chip clock frequency (PAL version, in Hertz).
 constexpr uint32_t AMIGA_PAULA_CLOCK_FREQ = 3546894UL;
@@ -131,6 +356,22 @@ constexpr uint16_t SAMPLES_PER_AMIGA_VBLANK = SAMPLING_FREQ / AMIGA_VBLANK_INT_F
 
 }  // namespace config
 
+#if MOD8_OPTION_EXTERNAL_STORAGE
+////////////////////////////////////////////////////////////////////////////////
+// Song storage, defined by the user application.
+////////////////////////////////////////////////////////////////////////////////
+namespace storage {
+
+/// @brief Read the song data, e.g. with one SPI burst. Never called from interrupt.
+/// @param address byte address in the storage.
+/// @param buffer buffer for `count` bytes.
+/// @param count ∈ [1; READ_AHEAD_LENGTH] bytes to read.
+/// The sample read-ahead may ask for up to READ_AHEAD_LENGTH bytes past the end of the song.
+void read(uint32_t address, uint8_t *buffer, uint8_t count);
+
+}  // namespace storage
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE
+
 ////////////////////////////////////////////////////////////////////////////////
 // Utility functions for working with memory.
 ////////////////////////////////////////////////////////////////////////////////
@@ -138,9 +379,34 @@ namespace memory {
 
 #if defined(ARDUINO)
 
+#if !MOD8_OPTION_EXTERNAL_STORAGE
 MOD8_ATTR_INLINE uint8_t read_song_byte(const uint8_t *addr) {
   return pgm_read_byte(addr);
 }
+#endif  // !MOD8_OPTION_EXTERNAL_STORAGE
+
+#if MOD8_OPTION_FAR_PROGMEM && defined(ARDUINO_ARCH_AVR)
+#if !defined(RAMPZ)
+#error "MOD8_OPTION_FAR_PROGMEM requires an AVR with more than 64 KiB of flash"
+#endif
+
+/// @brief Byte address of sample data in flash.
+using SampleAddress = uint32_t;
+/// @brief Size of song data.
+using SongSize = uint32_t;
+
+MOD8_ATTR_INLINE SampleAddress to_sample_address(const uint8_t *addr) {
+  return reinterpret_cast<uint16_t>(addr);
+}
+
+/// @brief Called from interrupt, so RAMPZ is restored for an interrupted ELPM read.
+MOD8_ATTR_INLINE uint8_t read_sample_byte(SampleAddress addr) {
+  const uint8_t rampz = RAMPZ;
+  const uint8_t value = pgm_read_byte_far(addr);
+  RAMPZ = rampz;
+  return value;
+}
+#endif  // MOD8_OPTION_FAR_PROGMEM && defined(ARDUINO_ARCH_AVR)
 
 MOD8_ATTR_INLINE uint8_t read_table_byte(const uint8_t *addr) {
   return pgm_read_byte(addr);
@@ -154,11 +420,18 @@ MOD8_ATTR_INLINE uint32_t read_table_dword(const uint32_t *addr) {
   return pgm_read_dword(addr);
 }
 
+/// @brief Prevents the compiler from reordering memory accesses across the call.
+MOD8_ATTR_INLINE void barrier() {
+  __asm__ __volatile__("" ::: "memory");
+}
+
 #else  // defined(ARDUINO)
 
+#if !MOD8_OPTION_EXTERNAL_STORAGE
 MOD8_ATTR_INLINE uint8_t read_song_byte(const uint8_t *addr) {
   return *addr;
 }
+#endif  // !MOD8_OPTION_EXTERNAL_STORAGE
 
 MOD8_ATTR_INLINE uint8_t read_table_byte(const uint8_t *addr) {
   return *addr;
@@ -172,7 +445,47 @@ MOD8_ATTR_INLINE uint32_t read_table_dword(const uint32_t *addr) {
   return *addr;
 }
 
+/// @brief Prevents the compiler from reordering memory accesses across the call.
+MOD8_ATTR_INLINE void barrier() {
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
 #endif  // defined(ARDUINO)
 
+#if MOD8_OPTION_EXTERNAL_STORAGE
+/// @brief Byte address of sample data in the storage.
+using SampleAddress = uint32_t;
+/// @brief Size of song data.
+using SongSize = uint32_t;
+
+/// @brief The song data pointers hold the addresses in the storage.
+MOD8_ATTR_INLINE SampleAddress to_sample_address(const uint8_t *addr) {
+  return static_cast<SampleAddress>(reinterpret_cast<uintptr_t>(addr));
+}
+
+MOD8_ATTR_INLINE void read_song_bytes(const uint8_t *addr, uint8_t *buffer, uint8_t count) {
+  storage::read(to_sample_address(addr), buffer, count);
+}
+
+MOD8_ATTR_INLINE uint8_t read_song_byte(const uint8_t *addr) {
+  uint8_t value;
+  read_song_bytes(addr, &value, 1);
+  return value;
+}
+#elif !MOD8_OPTION_FAR_PROGMEM || !defined(ARDUINO_ARCH_AVR)
+/// @brief Address of sample data.
+using SampleAddress = const uint8_t *;
+/// @brief Size of song data.
+using SongSize = size_t;
+
+MOD8_ATTR_INLINE SampleAddress to_sample_address(const uint8_t *addr) {
+  return addr;
+}
+
+MOD8_ATTR_INLINE uint8_t read_sample_byte(SampleAddress addr) {
+  return read_song_byte(addr);
+}
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE
+
 }  // namespace memory
 }  // namespace mod8
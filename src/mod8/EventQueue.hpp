@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+
+#if MOD8_OPTION_EVENT_QUEUE
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compact record of the player event, see Player::poll_event().
+////////////////////////////////////////////////////////////////////////////////
+struct Event {
+  enum class Kind : uint8_t {
+    ROW,      // The row was fetched; `order` and `row` are valid.
+    NOTE,     // A non-empty cell of the row; all fields are valid.
+    SONG_END  // The song has ended by itself.
+  };
+
+  uint16_t tick;    // Player tick of the event, see Player::get_tick_count().
+  uint16_t period;  // ∈ {0} ∪ [MIN_PERIOD; MAX_PERIOD]
+  Kind kind;        // ∈ {Kind}
+  uint8_t order;    // ∈ [0; NUM_ORDERS)
+  uint8_t row;      // ∈ [0; NUM_ROWS)
+  uint8_t channel;  // ∈ [0; NUM_CHANNELS)
+  uint8_t sample;   // ∈ [0; NUM_SAMPLES]
+  uint8_t effect;   // ∈ [0x0; 0xF]
+  uint8_t param;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Single-producer, single-consumer ring of player events from update() to the application.
+/// The application may drain it from loop() or from another interrupt.
+/// When the ring is full, new events are dropped and counted, so update() never waits.
+////////////////////////////////////////////////////////////////////////////////
+class EventQueue {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Drop all events. Call only when nothing polls the queue.
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    m_read = m_write = 0;
+    m_overflow_count = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Add the event, or count it as dropped if the queue is full.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void push(const Event &event) {
+    const uint8_t write = m_write;
+
+    if (static_cast<uint8_t>(write - m_read) == config::EVENT_QUEUE_LENGTH) {
+      if (m_overflow_count != 0xFFFFU) {
+        m_overflow_count = m_overflow_count + 1U;
+      }
+      return;
+    }
+
+    m_events[write & config::EVENT_QUEUE_MASK] = event;
+
+    // Publish the event only after it was written.
+    memory::barrier();
+    m_write = write + 1U;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Take the oldest event.
+  /// @return false if the queue is empty.
+  //////////////////////////////////////////////////////////////////////////////
+  bool pop(Event &event) {
+    const uint8_t read = m_read;
+
+    if (read == m_write) {
+      return false;
+    }
+
+    event = m_events[read & config::EVENT_QUEUE_MASK];
+
+    // Free the slot only after it was read.
+    memory::barrier();
+    m_read = read + 1U;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Number of dropped events, saturated at 0xFFFF.
+  /// @note Read it in the context of update(), the 16-bit read isn't atomic on AVR.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint16_t get_overflow_count() const {
+    return m_overflow_count;
+  }
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  // Indices are free-running.
+  Event m_events[config::EVENT_QUEUE_LENGTH];
+  volatile uint8_t m_read /* written by consumer */;
+  volatile uint8_t m_write /* written by producer */;
+  uint16_t m_overflow_count;
+};
+
+}  // namespace mod8
+
+#endif  // MOD8_OPTION_EVENT_QUEUE
@@ -31,7 +31,8 @@ namespace format {
 
 ////////////////////////////////////////////////////////////////////////////////
 constexpr uint8_t NUM_ORDERS = 128;
-constexpr uint8_t NUM_CHANNELS = 4;
+constexpr uint8_t NUM_CHANNELS = 4;      // of ProTracker songs, 6CHN and 8CHN songs have more
+constexpr uint8_t MAX_NUM_CHANNELS = 8;
 constexpr uint8_t NUM_FINETUNES = 16;
 constexpr uint8_t NUM_ROWS = 64;
 constexpr uint8_t NUM_SAMPLES = 31;
@@ -42,9 +43,16 @@ constexpr uint8_t MAX_FINETUNE = 15;
 constexpr uint8_t MAX_TICKS_PER_ROW = 31;
 
 ////////////////////////////////////////////////////////////////////////////////
+/// @brief Standard Protracker period range (notes C-1 to B-3).
+constexpr uint16_t AMIGA_MIN_PERIOD = 113;
+constexpr uint16_t AMIGA_MAX_PERIOD = 856;
+
 #if MOD8_OPTION_AMIGA_PERIODS
-constexpr uint16_t MIN_PERIOD = 113;
-constexpr uint16_t MAX_PERIOD = 856;
+// Playback speed must stay below 4 samples per output sample, so downsampling by 8 cuts off the top notes.
+constexpr uint16_t MIN_PERIOD = 28 * config::DOWNSAMPLING_FACTOR > AMIGA_MIN_PERIOD
+                                  ? 28 * config::DOWNSAMPLING_FACTOR
+                                  : AMIGA_MIN_PERIOD;
+constexpr uint16_t MAX_PERIOD = AMIGA_MAX_PERIOD;
 #else
 constexpr uint16_t MIN_PERIOD = 28 * config::DOWNSAMPLING_FACTOR;
 constexpr uint16_t MAX_PERIOD = 3424;
@@ -72,6 +80,34 @@ struct Sample {
 
 static_assert(sizeof(Sample) == 30, "Unexpected sample header struct size");
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compressed sample data.
+/// The sample header keeps the length and the loop points of the uncompressed sample.
+/// The data is the signature, then DELTA4_TABLE_LENGTH deltas, then a seed for every
+/// DELTA4_BLOCK_LENGTH samples, then 4-bit indices of the deltas, low nibble first.
+/// A sample is the sum of the deltas up to it, wrapped to 8 bits. A seed is the sum
+/// before the block, so the decoding can start at any block; 9xx offsets are block aligned.
+/// One more sample after the end stands for the byte the player may read past the sample.
+constexpr uint8_t DELTA4_SIGNATURE[] = { 'M', '8', 'D', '4' };
+constexpr uint8_t DELTA4_SIGNATURE_LENGTH = sizeof(DELTA4_SIGNATURE);
+constexpr uint8_t DELTA4_TABLE_LENGTH = 16;
+constexpr uint16_t DELTA4_BLOCK_LENGTH = 256;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Number of seeds of the compressed sample.
+/// @param length length of the uncompressed sample (in bytes).
+constexpr uint16_t get_delta4_seed_count(uint16_t length) {
+  return static_cast<uint16_t>(length / DELTA4_BLOCK_LENGTH + 1U);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Size of the compressed sample data, including the signature (in bytes).
+/// @param length length of the uncompressed sample (in bytes).
+constexpr uint32_t get_delta4_size(uint16_t length) {
+  return DELTA4_SIGNATURE_LENGTH + DELTA4_TABLE_LENGTH + get_delta4_seed_count(length)
+       + length / 2U + 1U;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 struct Song {
   uint8_t name[20];
@@ -101,16 +137,45 @@ struct Cell {
 static_assert(sizeof(Cell) == 4, "Unexpected cell struct size");
 
 ////////////////////////////////////////////////////////////////////////////////
-struct Row {
-  Cell notes[NUM_CHANNELS];
+template <uint8_t CHANNELS>
+struct BasicRow {
+  Cell notes[CHANNELS];
 };
 
+using Row = BasicRow<NUM_CHANNELS>;
+
 ////////////////////////////////////////////////////////////////////////////////
-struct Pattern {
-  Row rows[NUM_ROWS];
+template <uint8_t CHANNELS>
+struct BasicPattern {
+  BasicRow<CHANNELS> rows[NUM_ROWS];
 };
 
+using Pattern = BasicPattern<NUM_CHANNELS>;
+
 static_assert(sizeof(Pattern) == 1024, "Unexpected pattern data struct size");
+static_assert(sizeof(BasicPattern<MAX_NUM_CHANNELS>) == 2048, "Unexpected pattern data struct size");
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sample of SongLayout, after the checks and clamps of Player::load().
+struct SampleLayout {
+  uint32_t offset;       // of the sample data from the song begin (in bytes), past the signature if compressed
+  uint16_t length;       // in bytes, 0 if the sample is empty
+  uint16_t loop_start;   // in bytes
+  uint16_t loop_length;  // in bytes
+  uint8_t finetune;      // ∈ [0; MAX_FINETUNE]
+  uint8_t volume;        // ∈ [0; MAX_VOLUME]
+  uint8_t compressed;    // 1 if the data is compressed, see DELTA4_SIGNATURE
+  uint8_t loop_delta_sum;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Song header parsed in advance by `mod-to-inc.py --layout`.
+/// Lets Player::load() skip the parsing; the layout is kept in PROGMEM.
+struct SongLayout {
+  uint8_t order_count;
+  uint8_t pattern_count;
+  SampleLayout samples[NUM_SAMPLES];
+};
 
 }  // namespace format
 }  // namespace mod8
@@ -158,6 +158,38 @@ constexpr T maximum(const T& value1, const T& value2) {
   return value1 > value2 ? value1 : value2;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Compile-time sequence of indices [0; N), to generate tables.
+/// @note There is no <utility> header on AVR, so std::index_sequence is not available.
+////////////////////////////////////////////////////////////////////////////////
+template<uint16_t... INDICES>
+struct IndexSequence {};
+
+template<typename HEAD, typename TAIL>
+struct ConcatIndexSequence;
+
+template<uint16_t... HEAD, uint16_t... TAIL>
+struct ConcatIndexSequence<IndexSequence<HEAD...>, IndexSequence<TAIL...>> {
+  using type = IndexSequence<HEAD..., (sizeof...(HEAD) + TAIL)...>;
+};
+
+/// Builds halves recursively to keep template instantiation depth logarithmic.
+template<uint16_t N>
+struct MakeIndexSequence {
+  using type = typename ConcatIndexSequence<typename MakeIndexSequence<N / 2U>::type,
+                                            typename MakeIndexSequence<N - N / 2U>::type>::type;
+};
+
+template<>
+struct MakeIndexSequence<0> {
+  using type = IndexSequence<>;
+};
+
+template<>
+struct MakeIndexSequence<1> {
+  using type = IndexSequence<0>;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @name Unit tests at compile time, huh.
 //@{
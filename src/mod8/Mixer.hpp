@@ -0,0 +1,304 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+#include "Math.hpp"
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Output formats of the player, see BasicPlayer and Mixer.
+/// Each format makes the frame the interrupt routine needs from the mixed stereo pair,
+/// so the ISR doesn't convert it.
+////////////////////////////////////////////////////////////////////////////////
+namespace output {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Signed 16-bit stereo, the default.
+/// On AVR, Player::output_left_u8() and output_right_u8() return the high bytes.
+/// On host, the frame is an interleaved pair, see Player::render().
+////////////////////////////////////////////////////////////////////////////////
+struct Stereo {};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Duty cycles of two 8-bit PWM outputs, 0x80 is the silence.
+/// E.g. `OCR1AL = player.output().left; OCR1BL = player.output().right;`
+////////////////////////////////////////////////////////////////////////////////
+struct StereoPwm8 {
+  struct Frame {
+    uint8_t left;
+    uint8_t right;
+  };
+
+  MOD8_ATTR_INLINE static Frame format(int16_t left, int16_t right) {
+    return { static_cast<uint8_t>(math::hi_byte(static_cast<uint16_t>(left)) + 0x80U),
+             static_cast<uint8_t>(math::hi_byte(static_cast<uint16_t>(right)) + 0x80U) };
+  }
+
+  MOD8_ATTR_INLINE static void emit(const Frame & /*frame*/) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Duty cycle of a single 8-bit PWM output with the sum of both sides, 0x80 is the silence.
+/// E.g. `OCR2A = player.output().value;`
+////////////////////////////////////////////////////////////////////////////////
+struct MonoPwm8 {
+  struct Frame {
+    uint8_t value;
+  };
+
+  MOD8_ATTR_INLINE static Frame format(int16_t left, int16_t right) {
+    // Halves, so the sum fits into 16 bits.
+    // TODO: Avoid implementation-defined behaviour
+    const auto sum = static_cast<uint16_t>((left >> 1) + (right >> 1));
+    return { static_cast<uint8_t>(math::hi_byte(sum) + 0x80U) };
+  }
+
+  MOD8_ATTR_INLINE static void emit(const Frame & /*frame*/) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief 8-bit DAC on a port, e.g. an R-2R ladder, with the sum of both sides; 0x80 is the silence.
+/// Player::tick() writes the frame before mixing the next one, so the ISR only calls tick().
+/// @tparam Port type with `static void write(uint8_t value)`, e.g. `{ PORTD = value; }`.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Port>
+struct Dac8 {
+  using Frame = MonoPwm8::Frame;
+
+  MOD8_ATTR_INLINE static Frame format(int16_t left, int16_t right) {
+    return MonoPwm8::format(left, right);
+  }
+
+  MOD8_ATTR_INLINE static void emit(const Frame &frame) {
+    Port::write(frame.value);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Duty cycles of two 10-bit PWM outputs, 0x200 is the silence.
+/// E.g. Timer1 in the 10-bit fast PWM mode: `OCR1A = player.output().left; OCR1B = player.output().right;`
+////////////////////////////////////////////////////////////////////////////////
+struct StereoPwm10 {
+  struct Frame {
+    uint16_t left;
+    uint16_t right;
+  };
+
+  MOD8_ATTR_INLINE static Frame format(int16_t left, int16_t right) {
+    return { static_cast<uint16_t>((static_cast<uint16_t>(left) ^ 0x8000U) >> 6U),
+             static_cast<uint16_t>((static_cast<uint16_t>(right) ^ 0x8000U) >> 6U) };
+  }
+
+  MOD8_ATTR_INLINE static void emit(const Frame & /*frame*/) {}
+};
+
+}  // namespace output
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Output stage of the player: keeps the frame in the output format.
+/// With MOD8_OPTION_DOWNSAMPLING_WITH_LERP, also interpolates between the mixed frames.
+/// @tparam Output output format from the mod8::output namespace.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Output>
+class Mixer {
+public:
+  using Frame = typename Output::Frame;
+
+  /// @brief Frame of the output ring buffer.
+  using BufferFrame = Frame;
+
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    m_frame = Output::format(0, 0);
+#if MOD8_INTERNAL_LERP
+    m_level_left = m_level_right = 0;
+    m_slope_left = m_slope_right = 0;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Pass the frame on to the output, if the format does it itself.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void emit() const /* called from interrupt */ {
+    Output::emit(m_frame);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Set the output.
+  /// @param left ∈ [-32768; 32767]
+  /// @param right ∈ [-32768; 32767]
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void set(int16_t left, int16_t right) /* called from interrupt */ {
+    m_frame = Output::format(left, right);
+  }
+
+#if MOD8_INTERNAL_LERP
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Move the output by one step towards the target.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void step() /* called from interrupt */ {
+    m_level_left = static_cast<int16_t>(m_level_left + m_slope_left);
+    m_level_right = static_cast<int16_t>(m_level_right + m_slope_right);
+    m_frame = Output::format(m_level_left, m_level_right);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Reach the target in DOWNSAMPLING_FACTOR steps.
+  /// @param left ∈ [-16384; 16256]
+  /// @param right ∈ [-16384; 16256]
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void set_target(int16_t left, int16_t right) /* called from interrupt */ {
+    m_slope_left = static_cast<int16_t>((left - m_level_left) / config::DOWNSAMPLING_FACTOR);
+    m_slope_right = static_cast<int16_t>((right - m_level_right) / config::DOWNSAMPLING_FACTOR);
+  }
+#endif  // MOD8_INTERNAL_LERP
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE const Frame &frame() const /* called from interrupt */ {
+    return m_frame;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE BufferFrame pack() const {
+    return m_frame;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void unpack(const BufferFrame &frame) /* called from interrupt */ {
+    m_frame = frame;
+  }
+
+private:
+  Frame m_frame;
+
+#if MOD8_INTERNAL_LERP
+  int16_t m_level_left;
+  int16_t m_level_right;
+  int16_t m_slope_left;
+  int16_t m_slope_right;
+#endif
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Output stage for the default format.
+/// The frame itself is interpolated, and only its high bytes are buffered on AVR.
+////////////////////////////////////////////////////////////////////////////////
+template <>
+class Mixer<output::Stereo> {
+public:
+#if defined(ARDUINO_ARCH_AVR)
+  struct Frame {
+    math::Int16 left;
+    math::Int16 right;
+  };
+
+  struct BufferFrame {
+    uint8_t left;
+    uint8_t right;
+  };
+#else   // defined(ARDUINO_ARCH_AVR)
+  struct Frame {
+    int16_t left;
+    int16_t right;
+  };
+
+  using BufferFrame = Frame;
+#endif  // defined(ARDUINO_ARCH_AVR)
+
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    set(0, 0);
+#if MOD8_INTERNAL_LERP
+    m_slope_left = m_slope_right = 0;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void emit() const /* called from interrupt */ {}
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void set(int16_t left, int16_t right) /* called from interrupt */ {
+    m_frame = { { left }, { right } };
+  }
+
+#if MOD8_INTERNAL_LERP
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void step() /* called from interrupt */ {
+#if defined(ARDUINO_ARCH_AVR)
+    m_frame.left.s16 += m_slope_left;
+    m_frame.right.s16 += m_slope_right;
+#else   // defined(ARDUINO_ARCH_AVR)
+    m_frame.left = static_cast<int16_t>(m_frame.left + m_slope_left);
+    m_frame.right = static_cast<int16_t>(m_frame.right + m_slope_right);
+#endif  // defined(ARDUINO_ARCH_AVR)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void set_target(int16_t left, int16_t right) /* called from interrupt */ {
+#if defined(ARDUINO_ARCH_AVR)
+    m_slope_left = (left - m_frame.left.s16) / config::DOWNSAMPLING_FACTOR;
+    m_slope_right = (right - m_frame.right.s16) / config::DOWNSAMPLING_FACTOR;
+#else   // defined(ARDUINO_ARCH_AVR)
+    m_slope_left = static_cast<int16_t>((left - m_frame.left) / config::DOWNSAMPLING_FACTOR);
+    m_slope_right = static_cast<int16_t>((right - m_frame.right) / config::DOWNSAMPLING_FACTOR);
+#endif  // defined(ARDUINO_ARCH_AVR)
+  }
+#endif  // MOD8_INTERNAL_LERP
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE const Frame &frame() const /* called from interrupt */ {
+    return m_frame;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE BufferFrame pack() const {
+#if defined(ARDUINO_ARCH_AVR)
+    return { m_frame.left.b16.b1, m_frame.right.b16.b1 };
+#else
+    return m_frame;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void unpack(const BufferFrame &frame) /* called from interrupt */ {
+#if defined(ARDUINO_ARCH_AVR)
+    m_frame.left.b16.b1 = frame.left;
+    m_frame.right.b16.b1 = frame.right;
+#else
+    m_frame = frame;
+#endif
+  }
+
+private:
+  Frame m_frame;
+
+#if MOD8_INTERNAL_LERP
+  int16_t m_slope_left;
+  int16_t m_slope_right;
+#endif
+};
+
+}  // namespace mod8
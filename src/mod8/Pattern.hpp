@@ -0,0 +1,365 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+#include "Format.hpp"
+#include "Math.hpp"
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Effect handlers.
+/// Values 0x0..0xF are the effect numbers, extended effects Ex are mapped to 0x10 + x.
+////////////////////////////////////////////////////////////////////////////////
+enum Opcode : uint8_t {
+  OPCODE_ARPEGGIO = 0x0U,
+  OPCODE_PORTA_UP = 0x1U,
+  OPCODE_PORTA_DOWN = 0x2U,
+  OPCODE_PORTA_TO_NOTE = 0x3U,
+  OPCODE_VIBRATO = 0x4U,
+  OPCODE_PORTA_VOLUME_SLIDE = 0x5U,
+  OPCODE_VIBRATO_VOLUME_SLIDE = 0x6U,
+  OPCODE_TREMOLO = 0x7U,
+  OPCODE_PANNING = 0x8U,
+  OPCODE_SAMPLE_OFFSET = 0x9U,
+  OPCODE_VOLUME_SLIDE = 0xAU,
+  OPCODE_POSITION_JUMP = 0xBU,
+  OPCODE_SET_VOLUME = 0xCU,
+  OPCODE_PATTERN_BREAK = 0xDU,
+  OPCODE_SET_SPEED = 0xFU,
+
+  OPCODE_SET_FILTER = 0x10U,
+  OPCODE_FINE_PORTA_UP = 0x11U,
+  OPCODE_FINE_PORTA_DOWN = 0x12U,
+  OPCODE_GLISSANDO_CONTROL = 0x13U,
+  OPCODE_SET_VIBRATO_WAVEFORM = 0x14U,
+  OPCODE_SET_FINETUNE = 0x15U,
+  OPCODE_PATTERN_LOOP = 0x16U,
+  OPCODE_SET_TREMOLO_WAVEFORM = 0x17U,
+  OPCODE_SET_PANNING = 0x18U,
+  OPCODE_RETRIG_NOTE = 0x19U,
+  OPCODE_FINE_VOLUME_UP = 0x1AU,
+  OPCODE_FINE_VOLUME_DOWN = 0x1BU,
+  OPCODE_NOTE_CUT = 0x1CU,
+  OPCODE_NOTE_DELAY = 0x1DU,
+  OPCODE_PATTERN_DELAY = 0x1EU,
+  OPCODE_INVERT_LOOP = 0x1FU,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Unpacked pattern cell.
+////////////////////////////////////////////////////////////////////////////////
+struct Note {
+  uint16_t period;  // ∈ [0; 4095], 0 is no period
+  uint8_t sample;   // ∈ [0; 255], 0 is no sample
+  uint8_t opcode;   // ∈ {Opcode}
+  uint8_t param;    // raw effect parameter
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Effect number, as stored in the song.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint8_t effect() const {
+    return opcode < OPCODE_SET_FILTER ? opcode : 0xEU;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Unpack the bytes of the pattern cell.
+////////////////////////////////////////////////////////////////////////////////
+MOD8_ATTR_INLINE Note unpack_note(uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4) {
+  using math::hi_nibble;
+
+  /*
+    _____byte 1_____   byte2_    _____byte 3_____   byte4_
+    /                \ /      \  /                \ /      \
+    0000          0000-00000000  0000          0000-00000000
+
+    Upper four    12 bits for    Lower four    Effect command.
+    bits of sam-  note period.   bits of sam-
+    ple number.                  ple number.
+  */
+  const uint8_t effect = byte3 & 0xfU;
+
+  Note note;
+  note.period = static_cast<uint16_t>(((byte1 & 0xfU) << 8U) | byte2);
+  note.sample = static_cast<uint8_t>((byte1 & 0xf0U) | (byte3 >> 4U));
+  note.opcode = effect == 0xEU ? static_cast<uint8_t>(OPCODE_SET_FILTER + hi_nibble(byte4)) : effect;
+  note.param = byte4;
+  return note;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Unpack the pattern cell.
+/// @param cell PROGMEM pointer.
+////////////////////////////////////////////////////////////////////////////////
+MOD8_ATTR_INLINE Note decode_note(const format::Cell *cell) {
+  using memory::read_song_byte;
+
+  return unpack_note(read_song_byte(&cell->byte0),
+                     read_song_byte(&cell->byte1),
+                     read_song_byte(&cell->byte2),
+                     read_song_byte(&cell->byte3));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Unpack the notes of all channels in the pattern row.
+/// With MOD8_OPTION_EXTERNAL_STORAGE, the row is read from the storage in one go.
+/// @param row PROGMEM pointer.
+/// @param notes CHANNELS notes.
+////////////////////////////////////////////////////////////////////////////////
+template <uint8_t CHANNELS>
+MOD8_ATTR_INLINE void decode_row(const format::BasicRow<CHANNELS> *row, Note *notes) {
+#if MOD8_OPTION_EXTERNAL_STORAGE
+  format::BasicRow<CHANNELS> copy;
+  memory::read_song_bytes(reinterpret_cast<const uint8_t *>(row),
+                          reinterpret_cast<uint8_t *>(&copy),
+                          sizeof(copy));
+
+  for (uint8_t i = 0; i != CHANNELS; ++i) {
+    const format::Cell &cell = copy.notes[i];
+    notes[i] = unpack_note(cell.byte0, cell.byte1, cell.byte2, cell.byte3);
+  }
+#else   // MOD8_OPTION_EXTERNAL_STORAGE
+  for (uint8_t i = 0; i != CHANNELS; ++i) {
+    notes[i] = decode_note(row->notes + i);
+  }
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE
+}
+
+#if MOD8_OPTION_PATTERN_CACHE
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Decoded notes of the playing pattern and of the pattern that is expected next.
+/// The notes are decoded one row at a time, see prefetch().
+////////////////////////////////////////////////////////////////////////////////
+template <uint8_t CHANNELS>
+class PatternCache {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  PatternCache() = default;
+  ~PatternCache() = default;
+  PatternCache(const PatternCache &) = delete;
+  PatternCache &operator=(const PatternCache &) = delete;
+  PatternCache(PatternCache &&) = delete;
+  PatternCache &operator=(PatternCache &&) = delete;
+
+  //////////////////////////////////////////////////////////////////////////////
+  void reset(const format::BasicPattern<CHANNELS> *patterns, uint8_t pattern_count) {
+    m_patterns = patterns;
+    m_pattern_count = pattern_count;
+    m_current = 0;
+
+    for (uint8_t slot = 0; slot != NUM_SLOTS; ++slot) {
+      m_pattern[slot] = NO_PATTERN;
+      m_decoded[slot] = 0;
+    }
+
+    m_next_pattern = NO_PATTERN;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Start playing the pattern.
+  /// @param pattern pattern to play.
+  /// @param next_pattern pattern expected after it.
+  //////////////////////////////////////////////////////////////////////////////
+  void select(uint8_t pattern, uint8_t next_pattern) {
+    m_next_pattern = next_pattern;
+
+    if (m_pattern[m_current] == pattern) {
+      return;
+    }
+
+    // The slot of the previous pattern gets the next one.
+    m_current ^= 1U;
+
+    if (m_pattern[m_current] != pattern) {
+      m_pattern[m_current] = pattern;
+      m_decoded[m_current] = 0;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Get a row of the current pattern.
+  /// Decodes the row in place if it's not decoded yet.
+  /// @return CHANNELS notes.
+  //////////////////////////////////////////////////////////////////////////////
+  const Note *get_row(uint8_t row) {
+    const uint8_t slot = m_current;
+
+    if (row < m_decoded[slot]) {
+      return m_notes[slot][row];
+    }
+
+    // Rows are decoded in order, so only the first missing one is kept.
+    decode_row(slot, row);
+
+    if (row == m_decoded[slot]) {
+      ++m_decoded[slot];
+    }
+
+    return m_notes[slot][row];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Decode the next missing row of the current or the next pattern.
+  /// Must be called when there is nothing else to do.
+  //////////////////////////////////////////////////////////////////////////////
+  void prefetch() {
+    uint8_t slot = m_current;
+
+    // Don't read past the song data, the player reports bad pattern numbers itself.
+    if (m_decoded[slot] == format::NUM_ROWS || m_pattern[slot] >= m_pattern_count) {
+      if (m_next_pattern == m_pattern[slot] || m_next_pattern >= m_pattern_count) {
+        return;
+      }
+
+      slot ^= 1U;
+
+      if (m_pattern[slot] != m_next_pattern) {
+        m_pattern[slot] = m_next_pattern;
+        m_decoded[slot] = 0;
+      }
+
+      if (m_decoded[slot] == format::NUM_ROWS) {
+        return;
+      }
+    }
+
+    decode_row(slot, m_decoded[slot]);
+    ++m_decoded[slot];
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Whether prefetch() has nothing to decode.
+  //////////////////////////////////////////////////////////////////////////////
+  bool is_complete() const {
+    const uint8_t slot = m_current;
+
+    if (m_decoded[slot] != format::NUM_ROWS && m_pattern[slot] < m_pattern_count) {
+      return false;
+    }
+
+    if (m_next_pattern == m_pattern[slot] || m_next_pattern >= m_pattern_count) {
+      return true;
+    }
+
+    const uint8_t next_slot = slot ^ 1U;
+    return m_pattern[next_slot] == m_next_pattern && m_decoded[next_slot] == format::NUM_ROWS;
+  }
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  void decode_row(uint8_t slot, uint8_t row) {
+    mod8::decode_row(&m_patterns[m_pattern[slot]].rows[row], m_notes[slot][row]);
+  }
+
+  // ---------------------------------------------------------------------------
+
+  static constexpr uint8_t NUM_SLOTS = 2;
+  static constexpr uint8_t NO_PATTERN = 0xFFU;
+
+  Note m_notes[NUM_SLOTS][format::NUM_ROWS][CHANNELS];
+  uint8_t m_pattern[NUM_SLOTS];  // NO_PATTERN for empty slot
+  uint8_t m_decoded[NUM_SLOTS];  // ∈ [0; NUM_ROWS], the rows are decoded from the top
+  uint8_t m_current;             // slot of the playing pattern
+  uint8_t m_next_pattern;        // pattern to prefetch
+
+  const format::BasicPattern<CHANNELS> *m_patterns;  // NOTE: PROGMEM
+  uint8_t m_pattern_count;
+};
+
+#endif  // MOD8_OPTION_PATTERN_CACHE
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_PATTERN_CACHE
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Decoded notes of the row that is expected next, read during idle update() calls.
+/// Keeps the slow storage reads off the row boundaries.
+////////////////////////////////////////////////////////////////////////////////
+template <uint8_t CHANNELS>
+class RowPrefetcher {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  RowPrefetcher() = default;
+  ~RowPrefetcher() = default;
+  RowPrefetcher(const RowPrefetcher &) = delete;
+  RowPrefetcher &operator=(const RowPrefetcher &) = delete;
+  RowPrefetcher(RowPrefetcher &&) = delete;
+  RowPrefetcher &operator=(RowPrefetcher &&) = delete;
+
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    m_row = nullptr;
+    m_next_row = nullptr;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Set the row to prefetch.
+  /// @param row PROGMEM pointer, or nullptr if the next row is unknown.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void select(const format::BasicRow<CHANNELS> *row) {
+    m_next_row = row;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Read and decode the selected row, unless it's already there.
+  /// Must be called when there is nothing else to do.
+  //////////////////////////////////////////////////////////////////////////////
+  void prefetch() {
+    if (!is_complete()) {
+      decode_row(m_next_row, m_notes);
+      m_row = m_next_row;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Whether prefetch() has nothing to read.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool is_complete() const {
+    return m_next_row == m_row || m_next_row == nullptr;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Get the row, reading it now if it wasn't prefetched.
+  /// @return CHANNELS notes.
+  //////////////////////////////////////////////////////////////////////////////
+  const Note *get_row(const format::BasicRow<CHANNELS> *row) {
+    if (row != m_row) {
+      decode_row(row, m_notes);
+      m_row = row;
+    }
+
+    return m_notes;
+  }
+
+private:
+  Note m_notes[CHANNELS];
+  const format::BasicRow<CHANNELS> *m_row;       // NOTE: PROGMEM, the decoded row
+  const format::BasicRow<CHANNELS> *m_next_row;  // NOTE: PROGMEM, the row to prefetch
+};
+
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_PATTERN_CACHE
+
+}  // namespace mod8
@@ -24,16 +24,31 @@
 #pragma once
 
 #include "Channel.hpp"
+#include "CommandQueue.hpp"
+#include "EventQueue.hpp"
 #include "Format.hpp"
 #include "Math.hpp"
+#include "Mixer.hpp"
+#include "Pattern.hpp"
+#include "Profiling.hpp"
+#include "SongTraits.hpp"
 #include "Timer.hpp"
+#include "VoiceBank.hpp"
+
+#if defined(ARDUINO_ARCH_AVR)
+#include <avr/sleep.h>
+#endif
 
 namespace mod8 {
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Song info, without the name and the tag with MOD8_OPTION_SMALL_RAM.
 ////////////////////////////////////////////////////////////////////////////////
 struct Song {
+#if !MOD8_OPTION_SMALL_RAM
   uint8_t name[32];
   uint8_t tag[4];
+#endif
   uint8_t order_count;
   uint8_t pattern_count;
 };
@@ -103,9 +118,26 @@ void on_message(bool /*condition*/, uint8_t /*count*/, ...) {}
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Player for Amiga Protracker MOD tunes.
 /// Limitations:
-/// - MOD file size limited to 64KiB.
+/// - MOD file size limited to 64KiB, unless MOD8_OPTION_FAR_PROGMEM or MOD8_OPTION_EXTERNAL_STORAGE
+///   is enabled on AVR.
+/// @tparam Traits features of the songs to play, see DefaultSongTraits.
+/// @tparam NUM_CHANNELS 4, 6 (6CHN songs) or 8 (8CHN, OCTA songs).
+/// @tparam Output output format from the mod8::output namespace, see output().
 ////////////////////////////////////////////////////////////////////////////////
-class Player {
+template <typename Traits, uint8_t NUM_CHANNELS = format::NUM_CHANNELS, typename Output = output::Stereo>
+class BasicPlayer {
+  static_assert(Traits::NUM_SAMPLES >= 1 && Traits::NUM_SAMPLES <= format::NUM_SAMPLES,
+                "Unsupported number of samples");
+  static_assert(NUM_CHANNELS == 4 || NUM_CHANNELS == 6 || NUM_CHANNELS == 8, "Unsupported number of channels");
+  static_assert(NUM_CHANNELS == 4 || !MOD8_OPTION_ASM_MIXER, "MOD8_OPTION_ASM_MIXER supports only 4 channels");
+
+  using Channel = BasicChannel<Traits>;
+  using Row = format::BasicRow<NUM_CHANNELS>;
+  using Pattern = format::BasicPattern<NUM_CHANNELS>;
+
+  // Two voices per side use the full output range, more voices share it.
+  static constexpr int8_t OUTPUT_GAIN = NUM_CHANNELS == 4 ? 2 : 1;
+
 public:
   //////////////////////////////////////////////////////////////////////////////
   /// Remove all C++ boilerplate to:
@@ -114,30 +146,105 @@ public:
   /// - Avoid copying in tiny MCU's RAM.
   /// @note Call init() method before use the class.
   //////////////////////////////////////////////////////////////////////////////
-  Player() = default;
-  ~Player() = default;
-  Player(const Player &) = delete;
-  Player &operator=(const Player &) = delete;
-  Player(Player &&) = delete;
-  Player &operator=(Player &&) = delete;
+  BasicPlayer() = default;
+  ~BasicPlayer() = default;
+  BasicPlayer(const BasicPlayer &) = delete;
+  BasicPlayer &operator=(const BasicPlayer &) = delete;
+  BasicPlayer(BasicPlayer &&) = delete;
+  BasicPlayer &operator=(BasicPlayer &&) = delete;
 
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Initialize.
   /// Initialize minimum possible subset of vars.
   /// Must be called once before starting to work with the player.
+  /// On host, the player mixes at config::MIXING_FREQ, see init(uint32_t).
   //////////////////////////////////////////////////////////////////////////////
   void init() {
+#if !defined(ARDUINO_ARCH_AVR)
+    m_rate.init(config::MIXING_FREQ);
+#endif
+
     for (Channel &channel : m_channels) {
       channel.init();
+#if !defined(ARDUINO_ARCH_AVR)
+      channel.sampler().set_rate(&m_rate);
+#endif
     }
 
+    m_active_mask = 0;
     m_playing = false;
+
+#if MOD8_PARAM_SFX_VOICES > 0
+    for (SfxVoice &voice : m_sfx_voices) {
+      voice.sampler.init();
+#if !defined(ARDUINO_ARCH_AVR)
+      voice.sampler.set_rate(&m_rate);
+#endif
+    }
+#endif
+
+#if MOD8_OPTION_BUFFERED_OUTPUT
+    m_buffer_read = m_buffer_write = 0;
+#endif
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command_queue.reset();
+#endif
+
+#if MOD8_OPTION_EVENT_QUEUE
+    m_event_queue.reset();
+#endif
+    m_fast_forwarding = false;
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    m_tick_step = TICK_STEP_NONE;
+#endif
+
+#if MOD8_OPTION_CHECKPOINTS
+    m_checkpoints = nullptr;
+    m_checkpoint_capacity = m_checkpoint_count = 0;
+#endif
+  }
+
+#if !defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Initialize for the mixing frequency chosen at run time, instead of config::MIXING_FREQ.
+  /// The speed table and the tick length are calculated once here, not per note.
+  /// With config::MIXING_FREQ the output is the same as after init().
+  /// @param mixing_freq frequency of the tick() or render() frames, in Hertz.
+  /// @return false if a tick is shorter than a frame or doesn't fit the 16-bit tick timer.
+  //////////////////////////////////////////////////////////////////////////////
+  bool init(uint32_t mixing_freq) {
+    internal::Rate rate;
+
+    if (!rate.init(mixing_freq)) {
+      return false;
+    }
+
+    init();
+    m_rate = rate;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Mixing frequency in Hertz, given to init(uint32_t).
+  //////////////////////////////////////////////////////////////////////////////
+  uint32_t get_mixing_freq() const {
+    return m_rate.mixing_freq;
   }
+#endif  // !defined(ARDUINO_ARCH_AVR)
 
   //////////////////////////////////////////////////////////////////////////////
   struct Stats {
     uint8_t max_bpm;
     uint32_t playback_duration;
+#if MOD8_OPTION_PROFILING
+    profiling::Cost tick_cost;           // tick(), i.e. the interrupt routine.
+    profiling::Cost update_cost;         // update(), if a player tick was processed.
+    profiling::Cost fetch_row_cost;      // Fetching of a new row.
+    profiling::Cost channels_tick_cost;  // Channel::tick() of all channels.
+    uint16_t late_ticks;                 // Player ticks when update() was called too late.
+#endif
   };
 
   //////////////////////////////////////////////////////////////////////////////
@@ -145,63 +252,83 @@ public:
     return m_stats;
   }
 
+#if MOD8_OPTION_EVENT_QUEUE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Take the oldest recorded event.
+  /// May be called from loop() or from another interrupt, but from one place only.
+  /// Rows fetched while seeking or measuring the duration are not recorded.
+  /// @return false if there are no events.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool poll_event(Event &event) {
+    return m_event_queue.pop(event);
+  }
+
   //////////////////////////////////////////////////////////////////////////////
-  bool load(const uint8_t *data, size_t size) {
+  /// @brief Number of events dropped because the application didn't poll them in time.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint16_t get_dropped_event_count() const {
+    return m_event_queue.get_overflow_count();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Number of player ticks since the start of the song, wrapping around.
+  /// Compare with Event::tick to find out how long ago the event has happened.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint16_t get_tick_count() const {
+    return m_tick_count;
+  }
+#endif  // MOD8_OPTION_EVENT_QUEUE
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Number of update() calls needed to complete the player tick in progress.
+  /// @return 0 if no tick is in progress.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint8_t get_remaining_steps() const {
+    return m_tick_step == TICK_STEP_NONE ? 0 : TICK_STEP_END + 1U - m_tick_step;
+  }
+#endif  // MOD8_OPTION_INCREMENTAL_UPDATE
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Load the song and start playing it.
+  /// @param data PROGMEM song data. With MOD8_OPTION_EXTERNAL_STORAGE, the address of the song
+  /// in the storage cast to a pointer; on AVR, the patterns must end in the first 64 KiB then.
+  /// @param size song size in bytes.
+  //////////////////////////////////////////////////////////////////////////////
+  bool load(const uint8_t *data, memory::SongSize size) {
     using events::Message;
-    using events::on_sample_load;
     using events::on_song_load;
     using events::on_song_load_error;
     using events::on_message;
     using memory::read_song_byte;
-    using math::make_word;
-    using math::clamp;
-    using math::u8_to_s8;
-
-    m_playing = false;
-
-    // ---------------------------- Cleanup ------------------------------------
-    for (auto &channel : m_channels) {
-      channel.reset();
-    }
-
-    for (auto &state : m_pattern_state) {
-      state.reset();
-    }
-
-    m_output_left = m_output_right = { 0 };
-#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
-    m_mixing_counter = config::DOWNSAMPLING_FACTOR;
-#if MOD8_OPTION_DOWNSAMPLING_WITH_LERP
-    m_slope_left = m_slope_right = 0;
-#endif
-#endif
+    using memory::SampleAddress;
+    using memory::to_sample_address;
 
-    memset(&m_song_info, 0, sizeof(m_song_info));
-    memset(&m_samples[0], 0, sizeof(m_samples));
+    internal_begin_load(data);
 
     // ----------------------------- Parse -------------------------------------
-    m_song_data = reinterpret_cast<const format::Song *>(data);
-
-    uint8_t *dst = &m_song_info.name[0];
-    for (const auto &byte : m_song_data->name) {
-      *dst++ = read_song_byte(&byte);
-    }
+#if MOD8_OPTION_SMALL_RAM
+    uint8_t format_tag[sizeof(format::Song::format_tag)];
 
-    dst = &m_song_info.tag[0];
-    for (const auto &byte : m_song_data->format_tag) {
-      *dst++ = read_song_byte(&byte);
+    for (uint8_t i = 0; i != sizeof(format_tag); ++i) {
+      format_tag[i] = read_song_byte(&m_song_data->format_tag[i]);
     }
+#else
+    const uint8_t *const format_tag = m_song_info.tag;
+#endif
 
-    const uint8_t SUPPORTED_TAGS[][4] = {
-      { 'M', '.', 'K', '.' }, { '4', 'C', 'H', 'N' }, { 'F', 'L', 'T', '4' }
+    // The first byte of a tag is the number of channels.
+    const uint8_t SUPPORTED_TAGS[][5] = {
+      { 4, 'M', '.', 'K', '.' }, { 4, '4', 'C', 'H', 'N' }, { 4, 'F', 'L', 'T', '4' },
+      { 6, '6', 'C', 'H', 'N' }, { 8, '8', 'C', 'H', 'N' }, { 8, 'O', 'C', 'T', 'A' }
     };
 
     bool supported = false;
 
     for (const auto &tag : SUPPORTED_TAGS) {
       // NOTE: Lots of hardcode, but the binary code for AVR is more compact.
-      if (m_song_info.tag[0] == tag[0] && m_song_info.tag[1] == tag[1]
-          && m_song_info.tag[2] == tag[2] && m_song_info.tag[3] == tag[3]) {
+      if (tag[0] == NUM_CHANNELS && format_tag[0] == tag[1] && format_tag[1] == tag[2]
+          && format_tag[2] == tag[3] && format_tag[3] == tag[4]) {
         supported = true;
         break;
       }
@@ -212,10 +339,10 @@ public:
       on_message(true,
                  5,
                  (int)Message::UNSUPPORTED_FORMAT,
-                 (int)m_song_info.tag[0],
-                 (int)m_song_info.tag[1],
-                 (int)m_song_info.tag[2],
-                 (int)m_song_info.tag[3]);
+                 (int)format_tag[0],
+                 (int)format_tag[1],
+                 (int)format_tag[2],
+                 (int)format_tag[3]);
       return false;
     }
 
@@ -229,7 +356,7 @@ public:
 
     // ---------------------------- Patterns -----------------------------------
     m_song_info.order_count = read_song_byte(&m_song_data->length);
-    const auto *patterns = reinterpret_cast<const format::Pattern *>(m_song_data + 1);
+    const auto *patterns = reinterpret_cast<const Pattern *>(m_song_data + 1);
     {
       uint8_t pattern_count = 0;
 
@@ -244,264 +371,538 @@ public:
       m_song_info.pattern_count = pattern_count + 1U;
     }
 
+#if MOD8_INTERNAL_FAR_SAMPLES && defined(ARDUINO_ARCH_AVR)
+    // Only the sample data may lie beyond the reach of the near pointers.
+    if (to_sample_address(data) + sizeof(format::Song)
+          + static_cast<uint32_t>(m_song_info.pattern_count) * sizeof(Pattern)
+        > 0x10000UL) {
+      on_song_load_error(m_song_info);
+      on_message(true, 1, (int)Message::SONG_SIZE_TOO_BIG);
+      return false;
+    }
+#endif  // MOD8_INTERNAL_FAR_SAMPLES && defined(ARDUINO_ARCH_AVR)
+
     on_song_load(m_song_info);
 
     // ---------------------------- Samples ------------------------------------
-    const uint8_t *const data_end = data + size;
-    const auto *sample_data = reinterpret_cast<const uint8_t *>(
-      patterns + m_song_info.pattern_count);
+    const SampleAddress data_end = to_sample_address(data) + size;
+    SampleAddress sample_data = to_sample_address(
+      reinterpret_cast<const uint8_t *>(patterns + m_song_info.pattern_count));
     const format::Sample *sample_header = &m_song_data->samples[0];
 
-    for (uint8_t i = 0;
-         i != sizeof(format::Song::samples) / sizeof(format::Song::samples[0]);
-         ++i) {
+#if MOD8_OPTION_SMALL_RAM
+    m_song_layout = nullptr;
+    m_song_end = data_end;
+#endif
+
+    // Samples after the last used one can be skipped, the sample data goes in order.
+    for (uint8_t i = 0; i != Traits::NUM_SAMPLES; ++i) {
+#if MOD8_OPTION_SMALL_RAM
+      Sample sample;
+      m_sample_offsets[i] = static_cast<uint16_t>(sample_data - to_sample_address(data));
+#else
       Sample &sample = m_samples[i];
+#endif
 
-      const uint8_t byte_b1 = read_song_byte(&sample_header->length_lo);
-      const uint8_t byte_b2 = read_song_byte(&sample_header->length_hi);
-      const uint16_t length = make_word(byte_b2, byte_b1) * 2U;
-      const uint8_t *const sample_end = sample_data + length;
-
-      // some songs may have empty samples outside file boundaries
-      if (length > 2U && sample_end <= data_end) {
-        sample.begin = sample_data;
-        sample.end = sample.begin + length;
-
-        // ........................... Finetune ................................
-        uint8_t finetune = read_song_byte(&sample_header->finetune);
-        on_message(finetune > format::MAX_FINETUNE,
-                   3,
-                   (int)Message::OUT_OF_RANGE_SAMPLE_FINETUNE,
-                   (int)(i + 1),
-                   (int)finetune);
-        finetune = clamp<uint8_t>(finetune, 0U, format::MAX_FINETUNE);
-        sample.finetune = finetune;
-
-        // ............................ Volume .................................
-        uint8_t volume = read_song_byte(&sample_header->volume);
-        on_message(volume > format::MAX_VOLUME,
-                   3,
-                   (int)Message::OUT_OF_RANGE_SAMPLE_VOLUME,
-                   (int)(i + 1),
-                   (int)volume);
-        volume = clamp<uint8_t>(volume, 0U, format::MAX_VOLUME);
-        sample.volume = u8_to_s8(volume);
-
-        // .......................... Loop start ...............................
-        const uint8_t byte_c1 = read_song_byte(&sample_header->loop_start_lo);
-        const uint8_t byte_c2 = read_song_byte(&sample_header->loop_start_hi);
-        const uint16_t loop_start = make_word(byte_c2, byte_c1) * 2U;
-        sample.loop_begin = sample.begin + loop_start;
-
-        if (sample.loop_begin > data_end) {
-          on_message(
-            true, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 2);
-          return false;
-        }
+      if (!internal_parse_sample(i, sample_header, sample_data, data_end, true, sample)) {
+        return false;
+      }
 
-        // ......................... Loop length ...............................
-        const uint8_t byte_d1 = read_song_byte(&sample_header->loop_length_lo);
-        const uint8_t byte_d2 = read_song_byte(&sample_header->loop_length_hi);
-        const uint16_t loop_length = make_word(byte_d2, byte_d1) * 2U;
-        sample.loop_end = sample.loop_begin + loop_length;
+      ++sample_header;
+    }
 
-        if (sample.loop_end > data_end) {
-          on_message(
-            true, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 3);
-          return false;
-        }
+    internal_end_load();
+    return true;
+  }
 
-        if (loop_length < internal::MIN_LOOP_LENGTH && loop_start != 0) {
-          on_message(true,
-                     4,
-                     (int)Message::OUT_OF_RANGE_SAMPLE_LOOP_LENGTH,
-                     (int)(i + 1),
-                     (int)loop_length,
-                     (int)internal::MIN_LOOP_LENGTH);
-          return false;
-        }
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Load the song with the layout made by `mod-to-inc.py --layout` and start playing it.
+  /// Takes the same short time for any song: the header is not parsed and nothing is checked.
+  /// @param data the song data the layout was made for, see load(const uint8_t *, SongSize).
+  /// @param layout PROGMEM layout of the song.
+  //////////////////////////////////////////////////////////////////////////////
+  bool load(const uint8_t *data, const format::SongLayout *layout) {
+    using events::on_song_load;
+    using memory::read_table_byte;
 
-        sample_data = sample.end;
-        on_sample_load(i + 1U, sample);
-      } else {
-        on_message(
-          length > 2, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 1);
+    internal_begin_load(data);
 
-        sample.end = sample.begin = sample_data;
-        sample.loop_end = sample.loop_begin = sample_data;
+    m_song_info.order_count = read_table_byte(&layout->order_count);
+    m_song_info.pattern_count = read_table_byte(&layout->pattern_count);
+    on_song_load(m_song_info);
 
-        uint8_t volume = read_song_byte(&sample_header->volume);
-        on_message(volume > format::MAX_VOLUME,
-                   3,
-                   (int)Message::OUT_OF_RANGE_SAMPLE_VOLUME,
-                   (int)(i + 1),
-                   (int)volume);
-        volume = clamp<uint8_t>(volume, 0U, format::MAX_VOLUME);
-        sample.volume = u8_to_s8(volume);
+#if MOD8_OPTION_SMALL_RAM
+    // The samples are read from the layout when played.
+    m_song_layout = layout;
+#else
+    for (uint8_t i = 0; i != Traits::NUM_SAMPLES; ++i) {
+      internal_read_sample_layout(i, layout, m_samples[i]);
+    }
+#endif
 
-        if (sample.volume != 0) {
-          on_sample_load(i + 1U, sample);
-        }
-      }
+    internal_end_load();
+    return true;
+  }
 
-      ++sample_header;
-    }
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Jump to the row of the loaded song.
+  /// The song is replayed from the beginning at full speed without mixing,
+  /// so the tempo, effects, sample positions and output are the same as if it was played up to the row.
+  /// The playback callbacks aren't called during the replay.
+  /// @note Call only after a successful load(). The position must be reachable without jumping back.
+  /// @return false if the song ended before the position; the playback is stopped then.
+  //////////////////////////////////////////////////////////////////////////////
+  bool seek(uint8_t order, uint8_t row) {
+    m_playing = false;
 
-    // ----------------------------- State -------------------------------------
-    m_song_state = {};
-    m_song_state.ticks_per_row = format::INITIAL_SPEED;
+    m_fast_forwarding = true;
+
+    // Jumping back ends the song with PLAY_SONG_ONCE, so the replay always ends.
+    const Mode mode = m_song_state.mode;
+
+    internal_reset_playback();
     m_song_state.mode = Mode::PLAY_SONG_ONCE;
 
-    m_row_state = {};
-    m_row_actions = {};
+#if MOD8_OPTION_CHECKPOINTS
+    if (!internal_restore_checkpoint(order)) {
+      internal_start();
+    }
+#else   // MOD8_OPTION_CHECKPOINTS
+    internal_start();
+#endif  // MOD8_OPTION_CHECKPOINTS
 
-    m_stats = {};
-    m_stats.max_bpm = format::INITIAL_BPM;
+    // The row is reached right after the tick which has fetched it.
+    bool fetched = true;
 
-    m_tick_timer.reset(config::SAMPLES_PER_AMIGA_VBLANK);
+    while (!fetched || m_song_state.order != order || m_song_state.row != row) {
+      const uint16_t clocks = m_tick_timer.get_clocks_to_fire();
 
-    // ----------------------------- Initial -----------------------------------
-    // TODO: Do from update().
-    fetch_pattern();
-    fetch_row();
+      internal_fast_forward(clocks);
+      m_tick_timer.advance(clocks);
+      m_tick_timer.is_fired();
+
+      fetched = m_row_state.tick + 1U >= m_song_state.ticks_per_row && m_row_state.delay == 0;
+
+      if (!internal_tick()) {
+        m_song_state.mode = mode;
+        m_fast_forwarding = false;
+        return false;
+      }
+    }
 
+    m_song_state.mode = mode;
+    m_fast_forwarding = false;
     m_playing = true;
     return true;
   }
 
+#if MOD8_OPTION_CHECKPOINTS
   //////////////////////////////////////////////////////////////////////////////
-  // ~~~ 54 + 344 = 388 cloks ~~~
-  void tick() /* called from interrupt */ {
-    // ■■■■■■■■■■■■■
-    // ■  5 clocks ■
-    // ■■■■■■■■■■■■■
-    if (!m_playing) {
-      return;
-    }
+  /// @brief Snapshot of the player state at the start of an order.
+  struct Checkpoint;
 
-    // 28 clocks
-#if MOD8_OPTION_DOWNSAMPLING_WITH_LERP && MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
-    m_output_left.s16 += m_slope_left;
-    m_output_right.s16 += m_slope_right;
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Set the table for checkpoints, to be filled by scan_duration().
+  /// Checkpoints hold raw copies of the samplers, which point to the samples and the mixing rate
+  /// of the player, so they are valid only in the player that made them, with the same song.
+  /// @param table array of `capacity` checkpoints; NUM_ORDERS covers any song.
+  //////////////////////////////////////////////////////////////////////////////
+  void set_checkpoints(Checkpoint *table, uint8_t capacity) {
+    m_checkpoints = table;
+    m_checkpoint_capacity = capacity;
+    m_checkpoint_count = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint8_t get_checkpoint_count() const {
+    return m_checkpoint_count;
+  }
+#endif  // MOD8_OPTION_CHECKPOINTS
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Returned by scan_duration() for songs that never end.
+  static constexpr uint32_t INFINITE_DURATION = 0xFFFFFFFFUL;
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Measure the duration of the loaded song in the current mode.
+  /// The song is played through at full speed without mixing and the playback callbacks, then rewound.
+  /// An endless song is detected when the row flow state repeats.
+  /// With MOD8_OPTION_CHECKPOINTS, also fills the table set by set_checkpoints().
+  /// @note Call only after a successful load().
+  /// @return number of frames mixed until the end of the song, or INFINITE_DURATION.
+  //////////////////////////////////////////////////////////////////////////////
+  uint32_t scan_duration() {
+    m_playing = false;
+
+    m_fast_forwarding = true;
+
+    internal_reset_playback();
+    internal_start();
+
+    uint32_t duration = 0;
+
+#if MOD8_OPTION_CHECKPOINTS
+    // Until the song jumps back, every order is entered as with PLAY_SONG_ONCE in seek().
+    bool forward = true;
+    m_checkpoint_count = 0;
+    internal_add_checkpoint();
 #endif
 
-    // TODO: Mix only used channels
-#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
-#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
+    // Brent's cycle detection: compare with the state saved at the power-of-two steps.
+    FlowState saved;
+    internal_get_flow_state(saved);
+    uint32_t power = 1;
+    uint32_t steps = 0;
 
-    // -- 5 clocks --
-    if (m_mixing_counter & 1) {
-      // ~~ 200 clocks ~~
-      m_channels[0].fetch_sample();
-      m_channels[3].fetch_sample();
-    } else {
-      // ~~ 200 clocks ~~
-      m_channels[1].fetch_sample();
-      m_channels[2].fetch_sample();
-    }
-#else   // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
-    m_channels[m_mixing_counter - 1].fetch_sample();
-#endif  // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
+    for (;;) {
+      const uint16_t clocks = m_tick_timer.get_clocks_to_fire();
+      const uint32_t frames = static_cast<uint32_t>(clocks) * config::DOWNSAMPLING_FACTOR;
 
-    // -- 5 clocks --
-    if (--m_mixing_counter != 0) {
-      return;
-    }
+      if (duration >= INFINITE_DURATION - frames) {
+        duration = INFINITE_DURATION;
+        break;
+      }
 
-    // -- 4 clocks --
-    m_mixing_counter = config::DOWNSAMPLING_FACTOR;
-#else   // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
-    // ~~~~ 344 clocks ~~~~
-    m_channels[0].fetch_sample();
-    m_channels[1].fetch_sample();
-    m_channels[2].fetch_sample();
-    m_channels[3].fetch_sample();
-#endif  // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+      duration += frames;
 
-    // ■■■■■■■■■■■■■
-    // ■ 20 clocks ■
-    // ■■■■■■■■■■■■■
-    // NOTE: For the sake of economy, the adjustment of the degree of separation
-    //       of the right and left channels 0-100% is implemented in hardware.
-    // Range [-16384; 16256]
-    const int16_t new_left = m_channels[0].sampler().get_sample()
-                           + m_channels[3].sampler().get_sample();
+#if MOD8_OPTION_CHECKPOINTS
+      // Checkpoints need the sample positions and the output.
+      if (forward && m_checkpoint_count != m_checkpoint_capacity) {
+        internal_fast_forward(clocks);
+      }
+#endif
 
-    const int16_t new_right = m_channels[1].sampler().get_sample()
-                            + m_channels[2].sampler().get_sample();
+      m_tick_timer.advance(clocks);
+      m_tick_timer.is_fired();
 
+      const bool fetch = m_row_state.tick + 1U >= m_song_state.ticks_per_row
+                      && m_row_state.delay == 0;
 
-#if MOD8_OPTION_DOWNSAMPLING_WITH_LERP && MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
-    // -- 36 clocks --
-    // TODO: Avoid implementation-defined behaviour
-    // Range [-32640; 32640]
-    m_slope_left = (new_left - m_output_left.s16) / config::DOWNSAMPLING_FACTOR;
-    m_slope_right = (new_right - m_output_right.s16) / config::DOWNSAMPLING_FACTOR;
-#else
-    // ■■■■■■■■■■■■■
-    // ■ 12 clocks ■
-    // ■■■■■■■■■■■■■
-    // Range : [-32768; 32512]
-    // TODO: Avoid implementation-defined behaviour
-    // TODO: Shape with 1/2 LSB noise to avoid hearing of carrier frequency on low sampling rates?
-    m_output_left = { static_cast<int16_t>(new_left * 2) };
-    m_output_right = { static_cast<int16_t>(new_right * 2) };
+#if MOD8_OPTION_CHECKPOINTS
+      const uint8_t order = m_song_state.order;
+
+      if (fetch && (m_row_actions.actions & ACTION_JUMP_TO_ORDER)
+          && m_row_actions.jump_to_order <= order) {
+        forward = false;
+      }
 #endif
-    // ■■■■■■■■■■■■■■■■
-    // ■ 18/43 clocks ■
-    // ■■■■■■■■■■■■■■■■
-    m_tick_timer.clock();
-  }
 
-  //////////////////////////////////////////////////////////////////////////////
-  enum class UpdateResult : uint8_t {
-    INACTIVE,
-    IDLE,
-    TICK
-  };
+      if (!internal_tick()) {
+        break;
+      }
 
-  UpdateResult update() {
-    if (!m_playing) {
-      return UpdateResult::INACTIVE;
-    }
+#if MOD8_OPTION_CHECKPOINTS
+      if (m_song_state.order < order) {
+        forward = false;
+      }
 
-    if (!m_tick_timer.is_fired()) {
-      return UpdateResult::IDLE;
-    }
+      if (forward && m_song_state.order != order) {
+        internal_add_checkpoint();
+      }
+#endif
 
-    m_stats.playback_duration += static_cast<uint32_t>(m_tick_timer.get_period())
-                               * config::DOWNSAMPLING_FACTOR;
+      if (fetch) {
+        FlowState current;
+        internal_get_flow_state(current);
 
-    if (++m_row_state.tick >= m_song_state.ticks_per_row) {
-      m_row_state.tick = 0;
+        if (memcmp(&current, &saved, sizeof(FlowState)) == 0) {
+          duration = INFINITE_DURATION;
+          break;
+        }
 
-      if (m_row_state.delay != 0) {
-        m_row_state.delay--;
-      } else {
-        if (!internal_fetch_next_row()) {
-          stop();
-          return UpdateResult::TICK;
+        if (++steps == power) {
+          saved = current;
+          power *= 2U;
+          steps = 0;
         }
       }
     }
 
-    for (Channel &channel : m_channels) {
-      channel.tick();
-    }
+    // The first row is played again.
+    m_fast_forwarding = false;
 
-    return UpdateResult::TICK;
+    internal_reset_playback();
+    internal_start();
+    m_playing = true;
+    return duration;
   }
 
   //////////////////////////////////////////////////////////////////////////////
-  void stop() {
-    for (Channel &channel : m_channels) {
-      channel.reset();
-    }
+  /// @brief Mix next frame.
+  /// With MOD8_OPTION_BUFFERED_OUTPUT, only pops the frame mixed in advance by update().
+  /// With the output::Dac8 format, first writes the current frame to the port.
+  //////////////////////////////////////////////////////////////////////////////
+  void tick() /* called from interrupt */ {
+    m_mixer.emit();
 
-    m_playing = false;
+#if MOD8_OPTION_BUFFERED_OUTPUT
+    const uint8_t read = m_buffer_read;
 
-    events::on_play_song_end(m_song_info);
-  }
+    if (read == m_buffer_write) {
+      // Buffer underrun or nothing to play, keep the last frame.
+      return;
+    }
+
+#if MOD8_OPTION_PROFILING
+    const profiling::Probe probe{ m_stats.tick_cost };
+#endif
+
+    m_mixer.unpack(m_buffer[read & config::OUTPUT_BUFFER_MASK]);
+    m_buffer_read = read + 1U;
+#else   // MOD8_OPTION_BUFFERED_OUTPUT
+    // ■■■■■■■■■■■■■
+    // ■  5 clocks ■
+    // ■■■■■■■■■■■■■
+    if (!m_playing) {
+      return;
+    }
+
+#if MOD8_OPTION_PROFILING
+    const profiling::Probe probe{ m_stats.tick_cost };
+#endif
+
+    internal_mix();
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  enum class UpdateResult : uint8_t {
+    INACTIVE,
+    IDLE,
+    TICK,
+    PARTIAL  // With MOD8_OPTION_INCREMENTAL_UPDATE, the player tick isn't complete yet.
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Update notes, fetch next rows in patterns, etc.
+  /// With MOD8_OPTION_BUFFERED_OUTPUT, also mixes frames until the output buffer is full.
+  /// With MOD8_OPTION_INCREMENTAL_UPDATE, does one step of a player tick per call,
+  /// and nothing is mixed ahead until the tick is complete.
+  /// @return TICK if at least one player tick was processed, PARTIAL if the tick needs more calls.
+  /// With MOD8_OPTION_BUFFERED_OUTPUT, INACTIVE only after the interrupt has output all mixed frames.
+  //////////////////////////////////////////////////////////////////////////////
+  UpdateResult update() {
+#if MOD8_OPTION_BUFFERED_OUTPUT
+    UpdateResult result = m_playing ? UpdateResult::IDLE : UpdateResult::INACTIVE;
+
+    uint8_t write = m_buffer_write;
+
+    while (static_cast<uint8_t>(write - m_buffer_read) != config::OUTPUT_BUFFER_LENGTH) {
+      const UpdateResult tick_result = internal_update();
+
+      if (tick_result == UpdateResult::TICK) {
+        result = UpdateResult::TICK;
+      }
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+      // The frames of the tick are mixed after its last step.
+      if (tick_result == UpdateResult::PARTIAL) {
+        return tick_result;
+      }
+#endif
+
+      if (!m_playing) {
+        break;
+      }
+
+      internal_mix();
+
+      m_buffer[write & config::OUTPUT_BUFFER_MASK] = m_mixer.pack();
+
+      // Publish the frame only after it was written.
+      memory::barrier();
+      m_buffer_write = ++write;
+    }
+
+    // The end of the song is reported once the frames mixed before it are played.
+    if (result == UpdateResult::INACTIVE && m_buffer_read != write) {
+      result = UpdateResult::IDLE;
+    }
+
+    return result;
+#else   // MOD8_OPTION_BUFFERED_OUTPUT
+    return internal_update();
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Number of frames the interrupt will output before update() has work to do,
+  /// i.e. before the next player tick is due, so the application may schedule its own work into the gap.
+  /// With MOD8_OPTION_BUFFERED_OUTPUT, counts the frames until the output buffer is half empty.
+  /// @return 0 if update() has work now or nothing is playing.
+  //////////////////////////////////////////////////////////////////////////////
+  uint16_t get_frames_to_tick() const {
+#if defined(ARDUINO_ARCH_AVR)
+    // The interrupt changes the timer counter.
+    const uint8_t sreg = SREG;
+    cli();
+    const uint16_t frames = internal_get_frames_to_tick();
+    SREG = sreg;
+    return frames;
+#else   // defined(ARDUINO_ARCH_AVR)
+    return internal_get_frames_to_tick();
+#endif  // defined(ARDUINO_ARCH_AVR)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Sleep until update() has work to do, see get_frames_to_tick().
+  /// On AVR, the CPU idles between interrupts, so the interrupt calling tick() wakes it up every frame.
+  /// Call it with interrupts enabled, e.g. from loop() right after update().
+  /// Returns at once if nothing is playing, and always on other platforms.
+  //////////////////////////////////////////////////////////////////////////////
+  void wait_for_tick() {
+#if defined(ARDUINO_ARCH_AVR)
+    set_sleep_mode(SLEEP_MODE_IDLE);
+
+    for (;;) {
+      cli();
+
+      if (internal_get_frames_to_tick() == 0) {
+        sei();
+        return;
+      }
+
+      // The instruction after sei() is executed before any interrupt, so a pending one
+      // wakes the CPU right after it falls asleep.
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+#endif  // defined(ARDUINO_ARCH_AVR)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  void stop() {
+    // Stop the mixing first, it may apply queued commands.
+    m_playing = false;
+
+    for (Channel &channel : m_channels) {
+      channel.reset();
+    }
+
+    m_active_mask = 0;
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    m_tick_step = TICK_STEP_NONE;
+#endif
+
+    // The end of the song replayed by seek() or scan_duration() only stops the music.
+    if (m_fast_forwarding) {
+      return;
+    }
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command_queue.reset();
+#endif
+
+#if MOD8_PARAM_SFX_VOICES > 0
+    stop_sfx();
+#endif
+
+    events::on_play_song_end(m_song_info);
+  }
+
+#if MOD8_PARAM_SFX_VOICES > 0
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Play the sample of the loaded song as a sound effect on top of the music.
+  /// Sound effects are mixed while a song plays, stop() stops them too.
+  /// @param sample_no ∈ [1; Traits::NUM_SAMPLES] number of the sample in the song.
+  /// @param period ∈ [MIN_PERIOD; MAX_PERIOD] Amiga period, e.g. 428 for C-2.
+  /// @param volume ∈ [0; MAX_VOLUME]
+  /// @param priority a playing sound effect with a lower or the same priority may be stopped for this one.
+  /// @return false if the sample is empty or all voices play sound effects of higher priorities.
+  //////////////////////////////////////////////////////////////////////////////
+  bool trigger_sfx(uint8_t sample_no, uint16_t period, int8_t volume, uint8_t priority) {
+    if (sample_no == 0 || sample_no > Traits::NUM_SAMPLES) {
+      return false;
+    }
+
+#if MOD8_OPTION_SMALL_RAM
+    Sample sample;
+    internal_read_sample(sample_no - 1U, sample);
+    return trigger_sfx(sample, period, volume, priority);
+#else
+    return trigger_sfx(m_samples[sample_no - 1U], period, volume, priority);
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Play any sample as a sound effect on top of the music, e.g. signed 8-bit PCM data in PROGMEM.
+  /// The sample is copied. As in MOD files, a sample without a loop stops at the end
+  /// only if its first byte is 0, set loop_begin = loop_end = begin then.
+  /// @see trigger_sfx(uint8_t, uint16_t, int8_t, uint8_t)
+  //////////////////////////////////////////////////////////////////////////////
+  bool trigger_sfx(const Sample &sample, uint16_t period, int8_t volume, uint8_t priority) {
+    if (sample.begin == sample.end) {
+      return false;
+    }
+
+    // A free voice, or the one with the lowest priority.
+    SfxVoice *target = nullptr;
+
+    for (SfxVoice &voice : m_sfx_voices) {
+      if (!voice.sampler.is_active()) {
+        target = &voice;
+        break;
+      }
+
+      if (voice.priority <= priority && (target == nullptr || voice.priority < target->priority)) {
+        target = &voice;
+      }
+    }
+
+    if (target == nullptr) {
+      return false;
+    }
+
+    // The interrupt skips the voice until it's set up.
+    target->sampler.reset();
+    target->sample = sample;
+    target->priority = priority;
+
+    if (volume > format::MAX_VOLUME) {
+      volume = format::MAX_VOLUME;
+    }
+
+    target->sampler.retrig(&target->sample, period, 0, volume);
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    // Not a music channel, nothing to synchronize with.
+    Sampler::Command command;
+
+    if (target->sampler.take_command(command)) {
+      target->sampler.apply(command);
+    }
+#endif
+
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Stop all sound effects.
+  //////////////////////////////////////////////////////////////////////////////
+  void stop_sfx() {
+    for (SfxVoice &voice : m_sfx_voices) {
+      voice.sampler.reset();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Number of the playing sound effects.
+  //////////////////////////////////////////////////////////////////////////////
+  uint8_t get_sfx_count() const {
+    uint8_t count = 0;
+
+    for (const SfxVoice &voice : m_sfx_voices) {
+      if (voice.sampler.is_active()) {
+        ++count;
+      }
+    }
+
+    return count;
+  }
+#endif  // MOD8_PARAM_SFX_VOICES > 0
 
   //////////////////////////////////////////////////////////////////////////////
   enum class Mode : uint8_t {
@@ -516,34 +917,1057 @@ public:
     m_song_state.mode = mode;
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief The current frame in the Output format, e.g. `output().left` for output::StereoPwm8.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE const typename Mixer<Output>::Frame &output() const /* called from interrupt */ {
+    return m_mixer.frame();
+  }
+
   //////////////////////////////////////////////////////////////////////////////
 #if defined(ARDUINO_ARCH_AVR)
   MOD8_ATTR_INLINE uint8_t output_left_u8() const {
-    return m_output_left.b16.b1;
+    return m_mixer.frame().left.b16.b1;
   }
 
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE uint8_t output_right_u8() const {
-    return m_output_right.b16.b1;
+    return m_mixer.frame().right.b16.b1;
   }
 
 #else  // defined(ARDUINO_ARCH_AVR)
 
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE int16_t output_left_s16() const {
-    return m_output_left;
+    return m_mixer.frame().left;
   }
 
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE int16_t output_right_s16() const {
-    return m_output_right;
+    return m_mixer.frame().right;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Render a block of interleaved stereo frames.
+  /// Runs update() and tick() for each frame, so there is no need to call them.
+  /// @param interleaved buffer for `frames` pairs of left and right samples.
+  /// @param frames number of frames to render.
+  /// @return Number of rendered frames. Less than `frames` if the song is over.
+  //////////////////////////////////////////////////////////////////////////////
+  size_t render(int16_t *interleaved, size_t frames) {
+    return internal_render(interleaved, interleaved + 1, 2, frames);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Render a block of planar stereo frames.
+  /// Runs update() and tick() for each frame, so there is no need to call them.
+  /// @param left buffer for `frames` left channel samples.
+  /// @param right buffer for `frames` right channel samples.
+  /// @param frames number of frames to render.
+  /// @return Number of rendered frames. Less than `frames` if the song is over.
+  //////////////////////////////////////////////////////////////////////////////
+  size_t render(int16_t *left, int16_t *right, size_t frames) {
+    return internal_render(left, right, 1, frames);
   }
 
 #endif  // defined(ARDUINO_ARCH_AVR)
 
 private:
   //////////////////////////////////////////////////////////////////////////////
-  bool internal_fetch_next_row() {
+  // ~~~ 54 + 344 = 388 cloks ~~~
+  MOD8_ATTR_INLINE void internal_mix() /* called from interrupt */ {
+    // 28 clocks
+#if MOD8_INTERNAL_LERP
+    m_mixer.step();
+#endif
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    // -- 6 clocks if empty --
+    if (!m_command_queue.is_empty()) {
+      internal_apply_commands();
+    }
+#endif
+
+    // -- 2 clocks --
+    const uint8_t mask = m_active_mask;
+
+#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+    // Every call fetches the same number of voices: channel N on the call N mod DOWNSAMPLING_FACTOR.
+#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
+    // -- 5 clocks --
+    if (m_mixing_counter & 1) {
+      // ~~ 200 clocks with 4 channels ~~
+      internal_fetch_slice<0>(mask);
+    } else {
+      // ~~ 200 clocks with 4 channels ~~
+      internal_fetch_slice<1>(mask);
+    }
+#else   // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
+    switch (m_mixing_counter) {
+      case 1: internal_fetch_slice<0>(mask); break;
+      case 2: internal_fetch_slice<1>(mask); break;
+      case 3: internal_fetch_slice<2>(mask); break;
+      case 4: internal_fetch_slice<3>(mask); break;
+      case 5: internal_fetch_slice<4>(mask); break;
+      case 6: internal_fetch_slice<5>(mask); break;
+      case 7: internal_fetch_slice<6>(mask); break;
+      default: internal_fetch_slice<7>(mask); break;
+    }
+#endif  // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 == 1
+
+    // -- 5 clocks --
+    if (--m_mixing_counter != 0) {
+      return;
+    }
+
+    // -- 4 clocks --
+    m_mixing_counter = config::DOWNSAMPLING_FACTOR;
+#else   // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+    // ~~~~ 344 clocks max with 4 channels, 3 clocks per idle voice ~~~~
+    internal_fetch_slice<0>(mask);
+#endif  // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+
+#if MOD8_PARAM_SFX_VOICES > 0
+    // ~~ 90 clocks per playing voice ~~
+    internal_set_output(mask, internal_fetch_sfx());
+#else
+    internal_set_output(mask, 0);
+#endif
+
+    // ■■■■■■■■■■■■■■■■
+    // ■ 18/43 clocks ■
+    // ■■■■■■■■■■■■■■■■
+    m_tick_timer.clock();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Mix the current samples of the channels into the output, at the end of the mixing cycle.
+  /// @param sfx sum of the sound effect samples, 0 without MOD8_PARAM_SFX_VOICES.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void internal_set_output(uint8_t mask, int16_t sfx) /* called from interrupt */ {
+#if MOD8_PARAM_SFX_VOICES == 0
+    (void)sfx;
+#endif
+
+    // ■■■■■■■■■■■■■
+    // ■ 20 clocks ■
+    // ■■■■■■■■■■■■■
+    // NOTE: For the sake of economy, the adjustment of the degree of separation
+    //       of the right and left channels 0-100% is implemented in hardware.
+    // Amiga panning L R R L, repeated for the channels 4-7.
+    // Range [-16384; 16256] per two channels of a side.
+    int16_t new_left = internal_get_sample<0>(mask) + internal_get_sample<3>(mask)
+                     + internal_get_sample<4>(mask) + internal_get_sample<7>(mask);
+    int16_t new_right = internal_get_sample<1>(mask) + internal_get_sample<2>(mask)
+                      + internal_get_sample<5>(mask) + internal_get_sample<6>(mask);
+
+#if MOD8_PARAM_SFX_VOICES > 0
+    // -- 20 clocks for the clipping --
+    // Sound effects are centered, on top of the music.
+    new_left = internal_clip(static_cast<int32_t>(new_left) + sfx);
+    new_right = internal_clip(static_cast<int32_t>(new_right) + sfx);
+#endif
+
+#if MOD8_INTERNAL_LERP
+    // -- 36 clocks --
+    // TODO: Avoid implementation-defined behaviour
+    // Range [-32640; 32640]
+    // The interpolated output stays at the half scale, so the difference fits into 16 bits.
+    const int16_t target_left = OUTPUT_GAIN == 2 ? new_left : static_cast<int16_t>(new_left / 2);
+    const int16_t target_right = OUTPUT_GAIN == 2 ? new_right : static_cast<int16_t>(new_right / 2);
+    m_mixer.set_target(target_left, target_right);
+#else
+    // ■■■■■■■■■■■■■
+    // ■ 12 clocks ■
+    // ■■■■■■■■■■■■■
+    // Range : [-32768; 32512]
+    // TODO: Avoid implementation-defined behaviour
+    // TODO: Shape with 1/2 LSB noise to avoid hearing of carrier frequency on low sampling rates?
+    m_mixer.set(static_cast<int16_t>(new_left * OUTPUT_GAIN), static_cast<int16_t>(new_right * OUTPUT_GAIN));
+#endif
+  }
+
+#if MOD8_PARAM_SFX_VOICES > 0
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Fetch next samples of the sound effect voices.
+  /// @return sum of the samples ∈ [-8192 * SFX_VOICES; 8128 * SFX_VOICES]
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE int16_t internal_fetch_sfx() /* called from interrupt */ {
+    int16_t sum = 0;
+
+    for (SfxVoice &voice : m_sfx_voices) {
+      voice.sampler.fetch_sample();
+      sum += voice.sampler.get_sample();
+    }
+
+    return sum;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Sum of the current samples of the sound effect voices, without fetching.
+  //////////////////////////////////////////////////////////////////////////////
+  int16_t internal_get_sfx() const {
+    int16_t sum = 0;
+
+    for (const SfxVoice &voice : m_sfx_voices) {
+      sum += voice.sampler.get_sample();
+    }
+
+    return sum;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Clip the sum of the voices to the output range.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE static int16_t internal_clip(int32_t value) /* called from interrupt */ {
+    constexpr int16_t MAX_VALUE = 32767 / OUTPUT_GAIN;
+    constexpr int16_t MIN_VALUE = -32768 / OUTPUT_GAIN;
+
+    return value > MAX_VALUE ? MAX_VALUE : value < MIN_VALUE ? MIN_VALUE : static_cast<int16_t>(value);
+  }
+#endif  // MOD8_PARAM_SFX_VOICES > 0
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Fetch next samples of the channels FIRST, FIRST + DOWNSAMPLING_FACTOR, etc.
+  //////////////////////////////////////////////////////////////////////////////
+  template <uint8_t FIRST>
+  MOD8_ATTR_INLINE void internal_fetch_slice(uint8_t mask) /* called from interrupt */ {
+    constexpr uint8_t STEP = config::DOWNSAMPLING_FACTOR;
+
+    internal_fetch_sample<FIRST>(mask);
+    internal_fetch_sample<FIRST + STEP>(mask);
+    internal_fetch_sample<FIRST + STEP * 2U>(mask);
+    internal_fetch_sample<FIRST + STEP * 3U>(mask);
+    internal_fetch_sample<FIRST + STEP * 4U>(mask);
+    internal_fetch_sample<FIRST + STEP * 5U>(mask);
+    internal_fetch_sample<FIRST + STEP * 6U>(mask);
+    internal_fetch_sample<FIRST + STEP * 7U>(mask);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Fetch next sample of the channel, if it's in the active mask.
+  /// Compiles away for the channels the player doesn't have.
+  //////////////////////////////////////////////////////////////////////////////
+  template <uint8_t INDEX>
+  MOD8_ATTR_INLINE void internal_fetch_sample(uint8_t mask) /* called from interrupt */ {
+    if (INDEX < NUM_CHANNELS && (mask & (1U << (INDEX % NUM_CHANNELS)))) {
+      m_channels[INDEX % NUM_CHANNELS].fetch_sample();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Current sample of the channel, or 0 if it's not in the active mask.
+  /// Compiles away for the channels the player doesn't have.
+  //////////////////////////////////////////////////////////////////////////////
+  template <uint8_t INDEX>
+  MOD8_ATTR_INLINE int16_t internal_get_sample(uint8_t mask) const /* called from interrupt */ {
+    return (INDEX < NUM_CHANNELS && (mask & (1U << (INDEX % NUM_CHANNELS))))
+             ? m_channels[INDEX % NUM_CHANNELS].sampler().get_sample()
+             : 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Read the header of the sample and check the sample against the song data.
+  /// @param i index of the sample.
+  /// @param sample_data the sample data begin, moved to the end of the data.
+  /// @param report whether to report the sample and the issues; false when read again after load().
+  /// @return false if the sample is broken.
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_parse_sample(uint8_t i,
+                             const format::Sample *sample_header,
+                             memory::SampleAddress &sample_data,
+                             memory::SampleAddress data_end,
+                             bool report,
+                             Sample &sample) {
+    using events::Message;
+    using events::on_sample_load;
+    using events::on_message;
+    using memory::read_song_byte;
+    using memory::SampleAddress;
+    using math::make_word;
+    using math::clamp;
+    using math::u8_to_s8;
+
+    const uint8_t byte_b1 = read_song_byte(&sample_header->length_lo);
+    const uint8_t byte_b2 = read_song_byte(&sample_header->length_hi);
+    const uint16_t length = make_word(byte_b2, byte_b1) * 2U;
+    SampleAddress sample_end = sample_data + length;
+    SampleAddress loop_limit = data_end;
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    const bool compressed = length > 2U && internal::is_delta4(sample_data, data_end);
+
+    if (compressed) {
+      sample_end = sample_data + format::get_delta4_size(length);
+    }
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+
+    // some songs may have empty samples outside file boundaries
+    if (length > 2U && sample_end <= data_end) {
+      sample.begin = sample_data;
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+      // The positions stay those of the uncompressed sample, counted from the delta table.
+      sample.compressed = compressed;
+
+      if (compressed) {
+        sample.begin += format::DELTA4_SIGNATURE_LENGTH;
+        loop_limit = sample.begin + length;
+      }
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+
+      sample.end = sample.begin + length;
+
+      // ........................... Finetune ................................
+      uint8_t finetune = read_song_byte(&sample_header->finetune);
+      on_message(report && finetune > format::MAX_FINETUNE,
+                 3,
+                 (int)Message::OUT_OF_RANGE_SAMPLE_FINETUNE,
+                 (int)(i + 1),
+                 (int)finetune);
+      finetune = clamp<uint8_t>(finetune, 0U, format::MAX_FINETUNE);
+      sample.finetune = finetune;
+
+      // ............................ Volume .................................
+      uint8_t volume = read_song_byte(&sample_header->volume);
+      on_message(report && volume > format::MAX_VOLUME,
+                 3,
+                 (int)Message::OUT_OF_RANGE_SAMPLE_VOLUME,
+                 (int)(i + 1),
+                 (int)volume);
+      volume = clamp<uint8_t>(volume, 0U, format::MAX_VOLUME);
+      sample.volume = u8_to_s8(volume);
+
+      // .......................... Loop start ...............................
+      const uint8_t byte_c1 = read_song_byte(&sample_header->loop_start_lo);
+      const uint8_t byte_c2 = read_song_byte(&sample_header->loop_start_hi);
+      const uint16_t loop_start = make_word(byte_c2, byte_c1) * 2U;
+      sample.loop_begin = sample.begin + loop_start;
+
+      if (sample.loop_begin > loop_limit) {
+        on_message(
+          true, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 2);
+        return false;
+      }
+
+      // ......................... Loop length ...............................
+      const uint8_t byte_d1 = read_song_byte(&sample_header->loop_length_lo);
+      const uint8_t byte_d2 = read_song_byte(&sample_header->loop_length_hi);
+      const uint16_t loop_length = make_word(byte_d2, byte_d1) * 2U;
+      sample.loop_end = sample.loop_begin + loop_length;
+
+      if (sample.loop_end > loop_limit) {
+        on_message(
+          true, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 3);
+        return false;
+      }
+
+      if (loop_length < internal_get_min_loop_length() && loop_start != 0) {
+        on_message(true,
+                   4,
+                   (int)Message::OUT_OF_RANGE_SAMPLE_LOOP_LENGTH,
+                   (int)(i + 1),
+                   (int)loop_length,
+                   (int)internal_get_min_loop_length());
+        return false;
+      }
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+      sample.loop_delta_sum = compressed ? internal::get_delta4_sum(
+                                sample.begin,
+                                format::DELTA4_TABLE_LENGTH + format::get_delta4_seed_count(length),
+                                loop_start)
+                                         : 0U;
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+
+      sample_data = sample_end;
+
+      if (report) {
+        on_sample_load(i + 1U, sample);
+      }
+    } else {
+      on_message(
+        report && length > 2, 3, (int)Message::OUT_OF_RANGE_SAMPLE_BOUNDARIES, (int)(i + 1), 1);
+
+      sample.end = sample.begin = sample_data;
+      sample.loop_end = sample.loop_begin = sample_data;
+      sample.finetune = 0;
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+      sample.compressed = false;
+#endif
+
+      uint8_t volume = read_song_byte(&sample_header->volume);
+      on_message(report && volume > format::MAX_VOLUME,
+                 3,
+                 (int)Message::OUT_OF_RANGE_SAMPLE_VOLUME,
+                 (int)(i + 1),
+                 (int)volume);
+      volume = clamp<uint8_t>(volume, 0U, format::MAX_VOLUME);
+      sample.volume = u8_to_s8(volume);
+
+      if (report && sample.volume != 0) {
+        on_sample_load(i + 1U, sample);
+      }
+    }
+
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Read the sample of the song layout.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_read_sample_layout(uint8_t i, const format::SongLayout *layout, Sample &sample) const {
+    using memory::read_table_byte;
+    using memory::read_table_dword;
+    using memory::read_table_word;
+    using memory::to_sample_address;
+    using math::u8_to_s8;
+
+    const format::SampleLayout &sample_layout = layout->samples[i];
+    const memory::SampleAddress data = to_sample_address(reinterpret_cast<const uint8_t *>(m_song_data));
+
+    sample.begin = data + read_table_dword(&sample_layout.offset);
+    sample.end = sample.begin + read_table_word(&sample_layout.length);
+    sample.loop_begin = sample.begin + read_table_word(&sample_layout.loop_start);
+    sample.loop_end = sample.loop_begin + read_table_word(&sample_layout.loop_length);
+    sample.finetune = read_table_byte(&sample_layout.finetune);
+    sample.volume = u8_to_s8(read_table_byte(&sample_layout.volume));
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    sample.compressed = read_table_byte(&sample_layout.compressed) != 0;
+    sample.loop_delta_sum = read_table_byte(&sample_layout.loop_delta_sum);
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+  }
+
+#if MOD8_OPTION_SMALL_RAM
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Read the descriptor of the sample of the loaded song again.
+  /// @param i index of the sample.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_read_sample(uint8_t i, Sample &sample) {
+    using memory::to_sample_address;
+
+    if (m_song_layout != nullptr) {
+      internal_read_sample_layout(i, m_song_layout, sample);
+      return;
+    }
+
+    memory::SampleAddress sample_data = to_sample_address(reinterpret_cast<const uint8_t *>(m_song_data))
+                                      + m_sample_offsets[i];
+    internal_parse_sample(i, &m_song_data->samples[i], sample_data, m_song_end, false, sample);
+  }
+#endif  // MOD8_OPTION_SMALL_RAM
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Shorter loops are muted by the samplers, see internal::MIN_LOOP_LENGTH.
+  //////////////////////////////////////////////////////////////////////////////
+  uint16_t internal_get_min_loop_length() const {
+#if defined(ARDUINO_ARCH_AVR)
+    return internal::MIN_LOOP_LENGTH;
+#else
+    return m_rate.min_loop_length;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Stop the playback, forget the old song and copy the name and the tag of the new one.
+  /// The name and the tag aren't kept with MOD8_OPTION_SMALL_RAM.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_begin_load(const uint8_t *data) {
+    using memory::read_song_byte;
+
+    m_playing = false;
+
+    internal_reset_playback();
+
+#if MOD8_OPTION_CHECKPOINTS
+    m_checkpoint_count = 0;
+#endif
+
+    memset(&m_song_info, 0, sizeof(m_song_info));
+#if MOD8_OPTION_SMALL_RAM
+    memset(&m_sample_offsets[0], 0, sizeof(m_sample_offsets));
+#else
+    memset(&m_samples[0], 0, sizeof(m_samples));
+#endif
+
+    m_song_data = reinterpret_cast<const format::Song *>(data);
+
+#if !MOD8_OPTION_SMALL_RAM
+    uint8_t *dst = &m_song_info.name[0];
+    for (const auto &byte : m_song_data->name) {
+      *dst++ = read_song_byte(&byte);
+    }
+
+    dst = &m_song_info.tag[0];
+    for (const auto &byte : m_song_data->format_tag) {
+      *dst++ = read_song_byte(&byte);
+    }
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Start playing the loaded song.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_end_load() {
+    m_stats = {};
+#if MOD8_OPTION_PROFILING
+    m_stats.tick_cost.reset();
+    m_stats.update_cost.reset();
+    m_stats.fetch_row_cost.reset();
+    m_stats.channels_tick_cost.reset();
+#endif
+
+    m_song_state.mode = Mode::PLAY_SONG_ONCE;
+    internal_start();
+
+    m_playing = true;
+  }
+
+#if MOD8_OPTION_BUFFERED_OUTPUT
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Drop the mixed frames.
+  /// The read index is moved by the interrupt, so it's written with the interrupts disabled.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_drop_buffer() {
+#if defined(ARDUINO_ARCH_AVR)
+    const uint8_t sreg = SREG;
+    cli();
+    m_buffer_read = m_buffer_write;
+    SREG = sreg;
+#else   // defined(ARDUINO_ARCH_AVR)
+    m_buffer_read = m_buffer_write;
+#endif  // defined(ARDUINO_ARCH_AVR)
+  }
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Silence the channels and drop the mixed output.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_reset_playback() {
+#if MOD8_OPTION_BUFFERED_OUTPUT
+    internal_drop_buffer();
+#endif
+
+    for (auto &channel : m_channels) {
+      channel.reset();
+    }
+
+    m_active_mask = 0;
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command_queue.reset();
+#endif
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    m_tick_step = TICK_STEP_NONE;
+#endif
+
+    for (auto &state : m_pattern_state) {
+      state.reset();
+    }
+
+    m_mixer.reset();
+#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+    m_mixing_counter = config::DOWNSAMPLING_FACTOR;
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Set the initial song state and fetch the first row. Keeps the mode.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_start() {
+    const Mode mode = m_song_state.mode;
+
+    m_song_state = {};
+    m_song_state.ticks_per_row = format::INITIAL_SPEED;
+    m_song_state.mode = mode;
+
+    m_row_state = {};
+    m_row_actions = {};
+
+    // The profiling stats are kept over seek() and scan_duration().
+    m_stats.max_bpm = format::INITIAL_BPM;
+    m_stats.playback_duration = 0;
+
+#if defined(ARDUINO_ARCH_AVR)
+    m_tick_timer.reset(config::SAMPLES_PER_AMIGA_VBLANK);
+#else
+    m_tick_timer.reset(m_rate.samples_per_vblank);
+#endif
+
+#if MOD8_OPTION_EVENT_QUEUE
+    m_tick_count = 0;
+#endif
+
+#if MOD8_OPTION_PATTERN_CACHE
+    m_pattern_cache.reset(reinterpret_cast<const Pattern *>(m_song_data + 1),
+                          m_song_info.pattern_count);
+#elif MOD8_OPTION_EXTERNAL_STORAGE
+    m_row_prefetcher.reset();
+#endif
+
+    // TODO: Do from update().
+    fetch_pattern();
+    fetch_row();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Advance the samplers without mixing, as `clocks` calls of internal_mix() would.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_skip_samples(uint16_t clocks) {
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      if (m_active_mask & (1U << i)) {
+        m_channels[i].sampler().skip(clocks);
+      }
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Advance the samplers and the output by `clocks` mixing cycles, up to the player tick.
+  /// The output is left as if the frames were mixed, so the playback continues bit-exact.
+  /// Sound effects are not advanced.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_fast_forward(uint16_t clocks) {
+    const uint8_t mask = m_active_mask;
+
+#if MOD8_PARAM_SFX_VOICES > 0
+    const int16_t sfx = internal_get_sfx();
+#else
+    const int16_t sfx = 0;
+#endif
+
+#if MOD8_INTERNAL_LERP
+    // The interpolated output depends on every previous target, so each cycle is mixed.
+    for (; clocks != 0; --clocks) {
+      for (uint8_t i = 0; i != config::DOWNSAMPLING_FACTOR; ++i) {
+        m_mixer.step();
+      }
+
+      for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+        if (mask & (1U << i)) {
+          m_channels[i].fetch_sample();
+        }
+      }
+
+      internal_set_output(mask, sfx);
+    }
+#else   // MOD8_INTERNAL_LERP
+    // The output holds the last frame mixed before the tick.
+    internal_skip_samples(clocks);
+    internal_set_output(mask, sfx);
+#endif  // MOD8_INTERNAL_LERP
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Collect channels with active samplers into the mixing mask.
+  /// Muted channels stay in the mask to keep their sampling positions running.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_update_active_mask() {
+    uint8_t mask = 0;
+
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      if (m_channels[i].sampler().is_active()) {
+        mask |= 1U << i;
+      }
+    }
+
+    m_active_mask = mask;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Common part of get_frames_to_tick() and wait_for_tick().
+  /// @note On AVR, call with interrupts disabled.
+  //////////////////////////////////////////////////////////////////////////////
+  uint16_t internal_get_frames_to_tick() const {
+    if (!m_playing) {
+      return 0;
+    }
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    if (m_tick_step != TICK_STEP_NONE) {
+      return 0;
+    }
+#endif
+
+#if MOD8_OPTION_PATTERN_CACHE
+    if (!m_pattern_cache.is_complete()) {
+      return 0;
+    }
+#elif MOD8_OPTION_EXTERNAL_STORAGE
+    if (!m_row_prefetcher.is_complete()) {
+      return 0;
+    }
+#endif
+
+#if MOD8_OPTION_BUFFERED_OUTPUT
+    // update() clocks the timer, the interrupt only pops the frames.
+    const uint8_t fill = static_cast<uint8_t>(m_buffer_write - m_buffer_read);
+    constexpr uint8_t HALF = config::OUTPUT_BUFFER_LENGTH / 2U;
+    return fill > HALF ? static_cast<uint16_t>(fill - HALF) : 0;
+#else   // MOD8_OPTION_BUFFERED_OUTPUT
+    if (m_tick_timer.get_pending_count() != 0) {
+      return 0;
+    }
+
+    const uint16_t clocks = m_tick_timer.get_clocks_to_fire();
+
+#if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+    // The timer is clocked on every DOWNSAMPLING_FACTOR-th frame.
+    return static_cast<uint16_t>((clocks - 1U) * config::DOWNSAMPLING_FACTOR + m_mixing_counter);
+#else   // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+    return clocks;
+#endif  // MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  UpdateResult internal_update() {
+    if (!m_playing) {
+      return UpdateResult::INACTIVE;
+    }
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    if (m_tick_step != TICK_STEP_NONE) {
+#if MOD8_OPTION_PROFILING
+      const profiling::Probe probe{ m_stats.update_cost };
+#endif
+      return internal_tick_step();
+    }
+#endif  // MOD8_OPTION_INCREMENTAL_UPDATE
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    // The channels of the next tick start from the state the previous tick has made.
+    if (!m_command_queue.is_empty()) {
+      return UpdateResult::IDLE;
+    }
+#endif
+
+#if MOD8_OPTION_PROFILING
+    const uint8_t pending = m_tick_timer.get_pending_count();
+#endif
+
+    if (!m_tick_timer.is_fired()) {
+#if MOD8_OPTION_PATTERN_CACHE
+      m_pattern_cache.prefetch();
+#elif MOD8_OPTION_EXTERNAL_STORAGE
+      m_row_prefetcher.prefetch();
+#endif
+      return UpdateResult::IDLE;
+    }
+
+#if MOD8_OPTION_PROFILING
+    // The timer has fired more than once, so some player ticks were skipped.
+    if (pending > 1) {
+      ++m_stats.late_ticks;
+    }
+
+    const profiling::Probe probe{ m_stats.update_cost };
+#endif
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    m_tick_step = TICK_STEP_BEGIN;
+    return internal_tick_step();
+#else   // MOD8_OPTION_INCREMENTAL_UPDATE
+    internal_tick();
+    return UpdateResult::TICK;
+#endif  // MOD8_OPTION_INCREMENTAL_UPDATE
+  }
+
+#if !defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Do internal_update(), completing the player tick, if any, at once.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE UpdateResult internal_update_whole_tick() {
+    UpdateResult result = internal_update();
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+    while (result == UpdateResult::PARTIAL) {
+      result = internal_update();
+    }
+#endif
+
+    return result;
+  }
+#endif  // !defined(ARDUINO_ARCH_AVR)
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Process the player tick: fetch the next row, if it's time, and tick the channels.
+  /// @return false if the song is over and the playback was stopped.
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_tick() {
+    if (internal_begin_tick()) {
+#if MOD8_OPTION_PROFILING
+      const profiling::Probe row_probe{ m_stats.fetch_row_cost };
+#endif
+
+      if (!internal_fetch_next_row()) {
+        internal_end_song();
+        return false;
+      }
+    }
+
+    {
+#if MOD8_OPTION_PROFILING
+      const profiling::Probe channels_probe{ m_stats.channels_tick_cost };
+#endif
+
+      for (Channel &channel : m_channels) {
+        channel.tick();
+      }
+    }
+
+    internal_end_tick();
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Count the player tick.
+  /// @return true if it's time to fetch the next row.
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_begin_tick() {
+    m_stats.playback_duration += static_cast<uint32_t>(m_tick_timer.get_period())
+                               * config::DOWNSAMPLING_FACTOR;
+
+#if MOD8_OPTION_EVENT_QUEUE
+    ++m_tick_count;
+#endif
+
+    if (++m_row_state.tick < m_song_state.ticks_per_row) {
+      return false;
+    }
+
+    m_row_state.tick = 0;
+
+    if (m_row_state.delay != 0) {
+      m_row_state.delay--;
+      return false;
+    }
+
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Pass the changes of the player tick on to the mixing.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_end_tick() {
+    internal_update_active_mask();
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    internal_commit_commands();
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Stop the playback, the song is over.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_end_song() {
+#if MOD8_OPTION_EVENT_QUEUE
+    internal_record_event(Event::Kind::SONG_END, 0, 0, 0, 0, 0);
+#endif
+    stop();
+  }
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Do the next step of the player tick, the same work as internal_tick() in parts.
+  /// @return PARTIAL if more steps are left, TICK if the tick is complete or the song is over.
+  //////////////////////////////////////////////////////////////////////////////
+  UpdateResult internal_tick_step() {
+    uint8_t step = m_tick_step;
+
+    if (step == TICK_STEP_BEGIN) {
+      step = TICK_STEP_CHANNELS;
+
+      if (internal_begin_tick()) {
+        if (!internal_advance_row()) {
+          internal_end_song();
+          return UpdateResult::TICK;
+        }
+
+        internal_begin_row();
+        step = TICK_STEP_NOTES;
+      }
+    } else if (step < TICK_STEP_CHANNELS) {
+      const uint8_t i = step - TICK_STEP_NOTES;
+
+      play_note(i, internal_get_note(i));
+
+      if (++step == TICK_STEP_CHANNELS) {
+        internal_end_row();
+      }
+    } else if (step < TICK_STEP_END) {
+      m_channels[step - TICK_STEP_CHANNELS].tick();
+      ++step;
+    } else {
+      internal_end_tick();
+      m_tick_step = TICK_STEP_NONE;
+      return UpdateResult::TICK;
+    }
+
+    m_tick_step = step;
+    return UpdateResult::PARTIAL;
+  }
+#endif  // MOD8_OPTION_INCREMENTAL_UPDATE
+
+#if MOD8_OPTION_COMMAND_QUEUE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Pass the sampler changes of the tick to the interrupt, all at once.
+  /// Without playback, e.g. while seeking, nothing mixes, so they are applied right away.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_commit_commands() {
+    Sampler::Command command;
+    bool pushed = false;
+
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      Sampler &sampler = m_channels[i].sampler();
+
+      if (!sampler.take_command(command)) {
+        continue;
+      }
+
+      if (m_playing) {
+        m_command_queue.push(i, command);
+        pushed = true;
+      } else {
+        sampler.apply(command);
+      }
+    }
+
+    if (pushed) {
+      m_command_queue.publish();
+    } else if (!m_playing) {
+      internal_update_active_mask();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Apply the published sampler changes and update the mixing mask.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_apply_commands() /* called from interrupt */ {
+    do {
+      const auto &entry = m_command_queue.front();
+      m_channels[entry.channel].sampler().apply(entry.command);
+      m_command_queue.pop();
+    } while (!m_command_queue.is_empty());
+
+    internal_update_active_mask();
+  }
+#endif  // MOD8_OPTION_COMMAND_QUEUE
+
+#if !defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Do the same as the update() + tick() pair called for every frame.
+  /// Bypasses the output buffer, if any.
+  /// @return false if there is nothing to play.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool internal_render_frame() {
+    if (internal_update_whole_tick() == UpdateResult::INACTIVE) {
+      return false;
+    }
+
+    if (m_playing) {
+      internal_mix();
+    }
+
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Common part of the render() methods.
+  /// @param stride distance between consecutive samples of the same channel.
+  //////////////////////////////////////////////////////////////////////////////
+  size_t internal_render(int16_t *left, int16_t *right, size_t stride, size_t frames) {
+    size_t rendered = 0;
+
+#if MOD8_INTERNAL_SIMD_MIXER
+    // Nothing changes the samplers between player ticks,
+    // so the frames up to the next tick are mixed in one go.
+    while (rendered != frames) {
+      if (internal_update_whole_tick() == UpdateResult::INACTIVE) {
+        break;
+      }
+
+      size_t count = 1;
+
+      if (m_playing) {
+        count = m_tick_timer.get_clocks_to_fire();
+
+        if (count > frames - rendered) {
+          count = frames - rendered;
+        }
+
+        internal_mix_block(left + rendered * stride, right + rendered * stride, stride, count);
+      } else {
+        // The song is over on this tick, the last frame is repeated.
+        left[rendered * stride] = m_mixer.frame().left;
+        right[rendered * stride] = m_mixer.frame().right;
+      }
+
+      rendered += count;
+    }
+#else   // MOD8_INTERNAL_SIMD_MIXER
+    for (; rendered != frames && internal_render_frame(); ++rendered) {
+      left[rendered * stride] = m_mixer.frame().left;
+      right[rendered * stride] = m_mixer.frame().right;
+    }
+#endif  // MOD8_INTERNAL_SIMD_MIXER
+
+    return rendered;
+  }
+
+#if MOD8_INTERNAL_SIMD_MIXER
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Do the same as `frames` calls of internal_mix().
+  /// @param frames ∈ [1; m_tick_timer.get_clocks_to_fire()]
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_mix_block(int16_t *left, int16_t *right, size_t stride, size_t frames) {
+#if MOD8_OPTION_COMMAND_QUEUE
+    if (!m_command_queue.is_empty()) {
+      internal_apply_commands();
+    }
+#endif
+
+    const uint8_t mask = m_active_mask;
+    VoiceBank<NUM_CHANNELS> bank;
+
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      if (mask & (1U << i)) {
+        bank.load(i, m_channels[i].sampler());
+      } else {
+        bank.load_silence(i);
+      }
+    }
+
+    bank.mix(left, right, stride, frames);
+
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      if (mask & (1U << i)) {
+        bank.store(i, m_channels[i].sampler());
+      }
+    }
+
+    m_mixer.set(left[(frames - 1) * stride], right[(frames - 1) * stride]);
+    m_tick_timer.advance(static_cast<uint16_t>(frames));
+  }
+#endif  // MOD8_INTERNAL_SIMD_MIXER
+#endif  // !defined(ARDUINO_ARCH_AVR)
+
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_fetch_next_row() {
+    if (!internal_advance_row()) {
+      return false;
+    }
+
+    fetch_row();
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Move to the next row, fetching the pattern if it changes.
+  /// @return false if the song is over.
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_advance_row() {
     // TODO: Simplify the code.
     if (m_row_actions.actions & ACTION_STOP) {
       return false;
@@ -595,7 +2019,6 @@ private:
     }
 
     m_row_actions.actions = 0;
-    fetch_row();
     return true;
   }
 
@@ -611,313 +2034,569 @@ private:
     // TODO: Stop or panic
     on_message(pattern >= m_song_info.pattern_count, 1, (int)Message::OUT_OF_RANGE_PATTERN);
 
-    const auto *patterns = reinterpret_cast<const format::Pattern *>(m_song_data + 1);
+    const auto *patterns = reinterpret_cast<const Pattern *>(m_song_data + 1);
+
+    m_pattern_data = reinterpret_cast<const Row *>(&patterns[pattern]);
+
+#if MOD8_OPTION_PATTERN_CACHE
+    m_pattern_cache.select(pattern, internal_get_next_pattern(pattern));
+#endif
+
+    if (!m_fast_forwarding) {
+      on_play_pattern(m_song_state.order, pattern);
+    }
+  }
+
+#if MOD8_OPTION_PATTERN_CACHE || MOD8_OPTION_EXTERNAL_STORAGE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Guess the pattern that will be played after the current one.
+  /// Jumps to other positions are not taken into account.
+  //////////////////////////////////////////////////////////////////////////////
+  uint8_t internal_get_next_pattern(uint8_t pattern) const {
+    using memory::read_song_byte;
+
+    if (m_song_state.mode == Mode::LOOP_PATTERN) {
+      return pattern;
+    }
+
+    uint8_t order = m_song_state.order + 1U;
+
+    if (order >= m_song_info.order_count) {
+      order = 0;
+    }
+
+    return read_song_byte(&m_song_data->orders[order]);
+  }
+#endif  // MOD8_OPTION_PATTERN_CACHE || MOD8_OPTION_EXTERNAL_STORAGE
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_PATTERN_CACHE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Guess the row that will be fetched after the current one.
+  /// @return nullptr if the next pattern is out of range.
+  //////////////////////////////////////////////////////////////////////////////
+  const Row *internal_get_next_row() const {
+    if (m_song_state.row + 1U < format::NUM_ROWS) {
+      return &m_pattern_data[m_song_state.row + 1U];
+    }
+
+    const auto *patterns = reinterpret_cast<const Pattern *>(m_song_data + 1);
+    const auto current = static_cast<uint8_t>(
+      reinterpret_cast<const Pattern *>(m_pattern_data) - patterns);
+    const uint8_t pattern = internal_get_next_pattern(current);
 
-    m_pattern_data = reinterpret_cast<const format::Row *>(&patterns[pattern]);
+    if (pattern >= m_song_info.pattern_count) {
+      return nullptr;
+    }
+
+    return &patterns[pattern].rows[0];
+  }
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_PATTERN_CACHE
+
+#if MOD8_OPTION_EVENT_QUEUE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Record the event at the current position, unless the player fast-forwards.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_record_event(
+    Event::Kind kind, uint8_t channel, uint16_t period, uint8_t sample, uint8_t effect, uint8_t param) {
+    if (m_fast_forwarding) {
+      return;
+    }
 
-    on_play_pattern(m_song_state.order, pattern);
+    Event event;
+    event.tick = m_tick_count;
+    event.period = period;
+    event.kind = kind;
+    event.order = m_song_state.order;
+    event.row = m_song_state.row;
+    event.channel = channel;
+    event.sample = sample;
+    event.effect = effect;
+    event.param = param;
+    m_event_queue.push(event);
   }
+#endif  // MOD8_OPTION_EVENT_QUEUE
 
   //////////////////////////////////////////////////////////////////////////////
   void fetch_row() {
-    using events::on_message;
-    using events::on_play_note;
+    internal_begin_row();
+
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      play_note(i, internal_get_note(i));
+    }
+
+    internal_end_row();
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_begin_row() {
     using events::on_play_row_begin;
+
+    if (!m_fast_forwarding) {
+      on_play_row_begin(m_song_state.row);
+    }
+
+#if MOD8_OPTION_EVENT_QUEUE
+    internal_record_event(Event::Kind::ROW, 0, 0, 0, 0, 0);
+#endif
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Note of the channel in the current row.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE Note internal_get_note(uint8_t i) {
+#if MOD8_OPTION_PATTERN_CACHE
+    return m_pattern_cache.get_row(m_song_state.row)[i];
+#elif MOD8_OPTION_EXTERNAL_STORAGE
+    return m_row_prefetcher.get_row(&m_pattern_data[m_song_state.row])[i];
+#else   // MOD8_OPTION_PATTERN_CACHE
+    return decode_note(m_pattern_data[m_song_state.row].notes + i);
+#endif  // MOD8_OPTION_PATTERN_CACHE
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_end_row() {
     using events::on_play_row_end;
+
+#if MOD8_OPTION_EXTERNAL_STORAGE && !MOD8_OPTION_PATTERN_CACHE
+    // Read the next row during idle update() calls.
+    m_row_prefetcher.select(internal_get_next_row());
+#endif
+
+    if (!m_fast_forwarding) {
+      on_play_row_end();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Check at compile time whether the song uses the effect.
+  //////////////////////////////////////////////////////////////////////////////
+  static constexpr bool uses(Opcode opcode) {
+    return song_uses<Traits>(opcode_bit(opcode));
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  void play_note(uint8_t i, const Note &note) {
+    using events::on_message;
+    using events::on_play_note;
     using events::Message;
     using math::hi_nibble;
     using math::lo_nibble;
-    using memory::read_song_byte;
 
-    on_play_row_begin(m_song_state.row);
+    const uint16_t period = note.period;
+    const uint8_t sample = note.sample;
+    const uint8_t param = note.param;
 
-    const auto *notes = reinterpret_cast<const uint8_t *>(
-      m_pattern_data + m_song_state.row);
-    for (uint8_t i = 0; i != format::NUM_CHANNELS; ++i) {
-      /*
-        _____byte 1_____   byte2_    _____byte 3_____   byte4_
-        /                \ /      \  /                \ /      \
-        0000          0000-00000000  0000          0000-00000000
+    if (!m_fast_forwarding) {
+      on_play_note(i, period, sample, note.effect(), param);
+    }
 
-        Upper four    12 bits for    Lower four    Effect command.
-        bits of sam-  note period.   bits of sam-
-        ple number.                  ple number. 
-      */
-      const uint8_t byte1 = read_song_byte(notes++);
-      const uint8_t byte2 = read_song_byte(notes++);
-      const uint8_t byte3 = read_song_byte(notes++);
-      const uint8_t byte4 = read_song_byte(notes++);
+#if MOD8_OPTION_EVENT_QUEUE
+    if (period != 0 || sample != 0 || note.effect() != 0 || param != 0) {
+      internal_record_event(Event::Kind::NOTE, i, period, sample, note.effect(), param);
+    }
+#endif
 
-      const uint8_t sample = (byte1 & 0xf0U) | (byte3 >> 4U);
-      const auto period = static_cast<uint16_t>(((byte1 & 0xfU) << 8U) | byte2);
-      const uint8_t effect = byte3 & 0xfU;
-      const uint8_t param = byte4;
+    Channel &channel = m_channels[i];
 
-      on_play_note(i, period, sample, effect, param);
+    channel.reset_row();
 
-      Channel &channel = m_channels[i];
+    if (sample == 0) {
+      channel.set_sample(nullptr);
+    } else if (sample <= Traits::NUM_SAMPLES) {
+#if MOD8_OPTION_SMALL_RAM
+      Sample descriptor;
+      internal_read_sample(sample - 1U, descriptor);
+      channel.set_sample(&descriptor);
+#else
+      channel.set_sample(&m_samples[sample - 1]);
+#endif
+    } else {
+      on_message(true, 1, (int)Message::OUT_OF_RANGE_SAMPLE);
+    }
 
-      channel.reset_row();
+    on_message(period && (period < format::MIN_PERIOD || period > format::MAX_PERIOD),
+               1,
+               (int)Message::OUT_OF_RANGE_PERIOD);
+    channel.set_period(period);
 
-      if (sample == 0) {
-        channel.set_sample(nullptr);
-      } else if (sample <= format::NUM_SAMPLES) {
-        channel.set_sample(&m_samples[sample - 1]);
-      } else {
-        on_message(true, 1, (int)Message::OUT_OF_RANGE_SAMPLE);
-      }
+    switch (note.opcode) {
+      case OPCODE_ARPEGGIO:  // Normal play or Arpeggio
+        if (!uses(OPCODE_ARPEGGIO)) {
+          break;
+        }
 
-      on_message(period && (period < format::MIN_PERIOD || period > format::MAX_PERIOD),
-                 1,
-                 (int)Message::OUT_OF_RANGE_PERIOD);
-      channel.set_period(period);
+        if (param) {
+          channel.use_arpeggio(hi_nibble(param), lo_nibble(param));
+        }
+        break;
 
-      switch (effect) {
-        case 0x0:  // Normal play or Arpeggio
-          if (param) {
-            channel.use_arpeggio(hi_nibble(param), lo_nibble(param));
-          }
+      case OPCODE_PORTA_UP:
+        if (!uses(OPCODE_PORTA_UP)) {
+          break;
+        }
+
+        channel.use_period_dec(param);
+        break;
+
+      case OPCODE_PORTA_DOWN:
+        if (!uses(OPCODE_PORTA_DOWN)) {
+          break;
+        }
+
+        channel.use_period_inc(param);
+        break;
+
+      case OPCODE_PORTA_TO_NOTE:
+        if (!uses(OPCODE_PORTA_TO_NOTE)) {
           break;
+        }
+
+        channel.use_period_portamento(param);
+        break;
 
-        case 0x1:  // Porta Up
-          channel.use_period_dec(param);
+      case OPCODE_VIBRATO:
+        if (!uses(OPCODE_VIBRATO)) {
           break;
+        }
+
+        channel.use_period_vibrato(hi_nibble(param), lo_nibble(param));
+        break;
 
-        case 0x2:  // Porta Down
-          channel.use_period_inc(param);
+      case OPCODE_PORTA_VOLUME_SLIDE:
+        if (!uses(OPCODE_PORTA_VOLUME_SLIDE)) {
           break;
+        }
 
-        case 0x3:  // Porta To Note
-          channel.use_period_portamento(param);
+        channel.use_volume_dec(lo_nibble(param));
+        channel.use_volume_inc(hi_nibble(param));
+        channel.use_period_portamento(0);
+        break;
+
+      case OPCODE_VIBRATO_VOLUME_SLIDE:
+        if (!uses(OPCODE_VIBRATO_VOLUME_SLIDE)) {
           break;
+        }
+
+        channel.use_volume_dec(lo_nibble(param));
+        channel.use_volume_inc(hi_nibble(param));
+        channel.use_period_vibrato(0, 0);
+        break;
 
-        case 0x4:  // Vibrato
-          channel.use_period_vibrato(hi_nibble(param), lo_nibble(param));
+      case OPCODE_TREMOLO:
+        if (!uses(OPCODE_TREMOLO)) {
           break;
+        }
+
+        channel.use_volume_tremolo(hi_nibble(param), lo_nibble(param));
+        break;
 
-        case 0x5:  // Porta + Volume Slide
-          channel.use_volume_dec(lo_nibble(param));
-          channel.use_volume_inc(hi_nibble(param));
-          channel.use_period_portamento(0);
+      case OPCODE_SAMPLE_OFFSET:
+        if (!uses(OPCODE_SAMPLE_OFFSET)) {
           break;
+        }
+
+        channel.set_sample_offset(param);
+        break;
 
-        case 0x6:  // Vibrato + Volume Slide
-          channel.use_volume_dec(lo_nibble(param));
-          channel.use_volume_inc(hi_nibble(param));
-          channel.use_period_vibrato(0, 0);
+      case OPCODE_VOLUME_SLIDE:
+        if (!uses(OPCODE_VOLUME_SLIDE)) {
           break;
+        }
 
-        case 0x7:  // Tremolo
-          channel.use_volume_tremolo(hi_nibble(param), lo_nibble(param));
+        channel.use_volume_dec(lo_nibble(param));
+        channel.use_volume_inc(hi_nibble(param));
+        break;
+
+      case OPCODE_POSITION_JUMP:
+        if (!uses(OPCODE_POSITION_JUMP)) {
           break;
+        }
+
+        // B - Position Jump                       Bxx : songposition
+        //
+        // Causes playback to jump to pattern position xx.
+        // B00 would restart a song from the beginning (first pattern in the Order List).
+        // If Dxx is on the same row, the pattern specified by Bxx will be the pattern Dxx jumps in.
+        // Ranges from 00h to 7Fh (127; maximum amount of patterns for the MOD format).
+        on_message(param >= m_song_info.order_count, 1, (int)Message::OUT_OF_RANGE_EFFECT_PARAM);
+        m_row_actions.actions |= ACTION_JUMP_TO_ORDER;
+        m_row_actions.jump_to_order = param;
+        break;
 
-        case 0x9:  // Sample Offset
-          channel.set_sample_offset(param);
+      case OPCODE_SET_VOLUME:
+        if (!uses(OPCODE_SET_VOLUME)) {
           break;
+        }
+
+        channel.set_volume(param);
+        break;
 
-        case 0xA:  // Volume Slide
-          channel.use_volume_dec(lo_nibble(param));
-          channel.use_volume_inc(hi_nibble(param));
+      case OPCODE_PATTERN_BREAK:
+        if (!uses(OPCODE_PATTERN_BREAK)) {
           break;
+        }
 
-        case 0xB:
-          // B - Position Jump                       Bxx : songposition
-          //
-          // Causes playback to jump to pattern position xx.
-          // B00 would restart a song from the beginning (first pattern in the Order List).
-          // If Dxx is on the same row, the pattern specified by Bxx will be the pattern Dxx jumps in.
-          // Ranges from 00h to 7Fh (127; maximum amount of patterns for the MOD format).
-          on_message(param >= m_song_info.order_count, 1, (int)Message::OUT_OF_RANGE_EFFECT_PARAM);
-          m_row_actions.actions |= ACTION_JUMP_TO_ORDER;
-          m_row_actions.jump_to_order = param;
+        // D - Pattern Break                       Dxy : break position in next patt
+        //
+        // This effect is equivalent to a position jump to the next pattern in the
+        // pattern table, with the arguments x*10+y specifying the line within
+        // that pattern to start playing at. Note that this is NOT x*16+y.
+        {
+          const uint8_t param_x = hi_nibble(param);
+          const uint8_t param_y = lo_nibble(param);
+          const uint8_t pos = param_x * 10U + param_y;
+
+          on_message(pos >= format::NUM_ROWS,
+                     3,
+                     (int)Message::OUT_OF_RANGE_EFFECT_PARAM,
+                     (int)note.effect(),
+                     (int)param);
+
+          m_row_actions.actions |= ACTION_PATTERN_BREAK;
+          m_row_actions.jump_to_row = pos;
           break;
+        }
 
-        case 0xC:  // Set Volume
-          channel.set_volume(param);
+      case OPCODE_FINE_PORTA_UP:
+        if (!uses(OPCODE_FINE_PORTA_UP)) {
           break;
+        }
 
-        case 0xD:
-          // D - Pattern Break                       Dxy : break position in next patt
-          //
-          // This effect is equivalent to a position jump to the next pattern in the
-          // pattern table, with the arguments x*10+y specifying the line within
-          // that pattern to start playing at. Note that this is NOT x*16+y.
-          {
-            const uint8_t param_x = hi_nibble(param);
-            const uint8_t param_y = lo_nibble(param);
-            const uint8_t pos = param_x * 10U + param_y;
-
-            on_message(pos >= format::NUM_ROWS,
-                       3,
-                       (int)Message::OUT_OF_RANGE_EFFECT_PARAM,
-                       (int)effect,
-                       (int)param);
-
-            m_row_actions.actions |= ACTION_PATTERN_BREAK;
-            m_row_actions.jump_to_row = pos;
-            break;
-          }
+        channel.dec_period(lo_nibble(param));
+        break;
 
-        case 0xE:
-          {
-            const uint8_t ext_effect = param & 0xf0U;
-            const uint8_t ext_param = lo_nibble(param);
-
-            switch (ext_effect) {
-              case 0x10:  // Fine Portamento Up
-                channel.dec_period(ext_param);
-                break;
-
-              case 0x20:  // Fine Portamento Down
-                channel.inc_period(ext_param);
-                break;
-
-              case 0x60:
-                // E6 - Loop                           E60 : Set loop point
-                //                                     E6x : jump to loop, play x times
-                //
-                // This effect allows a section of a pattern to be 'looped', or played
-                // through, a certain number of times in succession. If the effect argument
-                // yyyy is zero, the effect specifies the loop's start point. Otherwise, it
-                // specifies the number of times to play this line and the preceeding lines
-                // from the start point. If no start point was specified in the current
-                // pattern being played, the loop start defaults to the first line in the
-                // pattern. Therefore, you cannot loop through multiple patterns.
-                {
-                  auto &state = m_pattern_state[i];
-
-                  if (!ext_param) {
-                    state.loop_start_row = m_song_state.row;
-                  } else {
-                    if (!state.loop_counter) {
-                      state.loop_counter = ext_param;
-                      m_row_actions.actions |= ACTION_JUMP_TO_ROW;
-                      m_row_actions.jump_to_row = state.loop_start_row;
-                    } else {
-                      if (--state.loop_counter) {
-                        m_row_actions.actions |= ACTION_JUMP_TO_ROW;
-                        m_row_actions.jump_to_row = state.loop_start_row;
-                      }
-                    }
-                  }
-                }
-
-                break;
-
-              case 0x90:  // Retrig Note
-                channel.use_note_repeat(ext_param);
-                break;
-
-              case 0xA0:  // Fine Volume Slide Up
-                channel.inc_volume(ext_param);
-                break;
-
-              case 0xB0:  // Fine Volume Slide Down
-                channel.dec_volume(ext_param);
-                break;
-
-              case 0xC0:  // Cut Note
-                channel.use_note_cut(ext_param);
-                break;
-
-              case 0xD0:  // Delay Note
-                channel.use_note_delay(ext_param);
-                break;
-
-              case 0xE0:  // Pattern Delay
-                m_row_state.delay = ext_param;
-                break;
-
-              case 0x00:  // Set Filter
-              case 0x30:  // Glissando Control
-              case 0x40:  // Set Vibrato Waveform
-              case 0x50:  // Set Finetune
-              case 0x70:  // Set Tremolo Waveform
-              case 0x80:  // Set Panning
-              case 0xF0:  // Invert Loop
-              default:
-                on_message(true, 3, (int)Message::UNSUPPORTED_EFFECT, (int)effect, (int)param);
-                break;
-            }
+      case OPCODE_FINE_PORTA_DOWN:
+        if (!uses(OPCODE_FINE_PORTA_DOWN)) {
+          break;
+        }
 
-            break;
-          }
+        channel.inc_period(lo_nibble(param));
+        break;
 
-        case 0xF:  // Set Speed
-          if (param == 0) {
-#if MOD8_OPTION_STOP_ON_F00_CMD
-            m_row_actions.actions |= ACTION_STOP;
-#endif
-          } else if (param <= format::MAX_TICKS_PER_ROW) {
-            m_song_state.ticks_per_row = param;
+      case OPCODE_PATTERN_LOOP:
+        if (!uses(OPCODE_PATTERN_LOOP)) {
+          break;
+        }
+
+        // E6 - Loop                           E60 : Set loop point
+        //                                     E6x : jump to loop, play x times
+        //
+        // This effect allows a section of a pattern to be 'looped', or played
+        // through, a certain number of times in succession. If the effect argument
+        // yyyy is zero, the effect specifies the loop's start point. Otherwise, it
+        // specifies the number of times to play this line and the preceeding lines
+        // from the start point. If no start point was specified in the current
+        // pattern being played, the loop start defaults to the first line in the
+        // pattern. Therefore, you cannot loop through multiple patterns.
+        {
+          const uint8_t ext_param = lo_nibble(param);
+          auto &state = m_pattern_state[i];
+
+          if (!ext_param) {
+            state.loop_start_row = m_song_state.row;
           } else {
-            // BPM - Beats Per Minute.
-            // LPM - Lines Per Minute.
-            // TPS - Ticks Per Second.
-
-            // LPM = BPM * 4
-            // LPS = LPM / 60 = BPM * 4 / 60
-            // TPS = BPM * (4 / 60) * DEFAULT_SPEED = BPM * (4 / 60) * 6
-            // TPS = BPM * (24 / 60) = BPM * (4 / 10) = BPM * 2 / 5
-
-            // Default BPM = 125
-            // Default TPS = 125 * 2 / 5 = 50 ~ VBLANK
-
-            // TIMER_PERIOD = SAMPLING_FREQ / TPS
-            // TIMER_PERIOD = SAMPLING_FREQ * 5 / (2 * param)
-            // TIMER_PERIOD ∈ [306; 3906]
-            m_stats.max_bpm = math::maximum(m_stats.max_bpm, param);
-
-            const auto tick_period = static_cast<uint16_t>(
-              5UL * config::SAMPLING_FREQ / param / 2U);
-            m_tick_timer.set_period(tick_period);
+            if (!state.loop_counter) {
+              state.loop_counter = ext_param;
+              m_row_actions.actions |= ACTION_JUMP_TO_ROW;
+              m_row_actions.jump_to_row = state.loop_start_row;
+            } else {
+              if (--state.loop_counter) {
+                m_row_actions.actions |= ACTION_JUMP_TO_ROW;
+                m_row_actions.jump_to_row = state.loop_start_row;
+              }
+            }
           }
 
           break;
+        }
 
-        case 0x8:  // Panning
-        default:
-          on_message(true, 3, (int)Message::UNSUPPORTED_EFFECT, (int)effect, (int)param);
+      case OPCODE_RETRIG_NOTE:
+        if (!uses(OPCODE_RETRIG_NOTE)) {
           break;
-      }
-    }
+        }
+
+        channel.use_note_repeat(lo_nibble(param));
+        break;
+
+      case OPCODE_FINE_VOLUME_UP:
+        if (!uses(OPCODE_FINE_VOLUME_UP)) {
+          break;
+        }
+
+        channel.inc_volume(lo_nibble(param));
+        break;
+
+      case OPCODE_FINE_VOLUME_DOWN:
+        if (!uses(OPCODE_FINE_VOLUME_DOWN)) {
+          break;
+        }
+
+        channel.dec_volume(lo_nibble(param));
+        break;
+
+      case OPCODE_NOTE_CUT:
+        if (!uses(OPCODE_NOTE_CUT)) {
+          break;
+        }
+
+        channel.use_note_cut(lo_nibble(param));
+        break;
+
+      case OPCODE_NOTE_DELAY:
+        if (!uses(OPCODE_NOTE_DELAY)) {
+          break;
+        }
+
+        channel.use_note_delay(lo_nibble(param));
+        break;
+
+      case OPCODE_PATTERN_DELAY:
+        if (!uses(OPCODE_PATTERN_DELAY)) {
+          break;
+        }
+
+        m_row_state.delay = lo_nibble(param);
+        break;
+
+      case OPCODE_SET_SPEED:
+        if (!uses(OPCODE_SET_SPEED)) {
+          break;
+        }
+
+        if (param == 0) {
+#if MOD8_OPTION_STOP_ON_F00_CMD
+          m_row_actions.actions |= ACTION_STOP;
+#endif
+        } else if (param <= format::MAX_TICKS_PER_ROW) {
+          m_song_state.ticks_per_row = param;
+        } else {
+          // BPM - Beats Per Minute.
+          // LPM - Lines Per Minute.
+          // TPS - Ticks Per Second.
+
+          // LPM = BPM * 4
+          // LPS = LPM / 60 = BPM * 4 / 60
+          // TPS = BPM * (4 / 60) * DEFAULT_SPEED = BPM * (4 / 60) * 6
+          // TPS = BPM * (24 / 60) = BPM * (4 / 10) = BPM * 2 / 5
+
+          // Default BPM = 125
+          // Default TPS = 125 * 2 / 5 = 50 ~ VBLANK
+
+          // TIMER_PERIOD = SAMPLING_FREQ / TPS
+          // TIMER_PERIOD = SAMPLING_FREQ * 5 / (2 * param)
+          // TIMER_PERIOD ∈ [306; 3906]
+          m_stats.max_bpm = math::maximum(m_stats.max_bpm, param);
+
+#if defined(ARDUINO_ARCH_AVR)
+          const auto tick_period = static_cast<uint16_t>(
+            5UL * config::SAMPLING_FREQ / param / 2U);
+#else
+          const auto tick_period = static_cast<uint16_t>(
+            5UL * m_rate.sampling_freq / param / 2U);
+#endif
+          m_tick_timer.set_period(tick_period);
+        }
+
+        break;
 
-    on_play_row_end();
+      case OPCODE_PANNING:
+      case OPCODE_SET_FILTER:
+      case OPCODE_GLISSANDO_CONTROL:
+      case OPCODE_SET_VIBRATO_WAVEFORM:
+      case OPCODE_SET_FINETUNE:
+      case OPCODE_SET_TREMOLO_WAVEFORM:
+      case OPCODE_SET_PANNING:
+      case OPCODE_INVERT_LOOP:
+      default:
+        on_message(true, 3, (int)Message::UNSUPPORTED_EFFECT, (int)note.effect(), (int)param);
+        break;
+    }
   }
 
   //////////////////////////////////////////////////////////////////////////////
   volatile bool m_playing;
+  volatile uint8_t m_active_mask /* read from interrupt */;  // bit N = channel N
+
+#if MOD8_OPTION_COMMAND_QUEUE
+  CommandQueue<NUM_CHANNELS> m_command_queue;
+#endif
 
+#if MOD8_OPTION_EVENT_QUEUE
+  EventQueue m_event_queue;
+  uint16_t m_tick_count;
+#endif
+
+  bool m_fast_forwarding;  // seek() or scan_duration() replays the song.
+
+#if MOD8_OPTION_INCREMENTAL_UPDATE
   //////////////////////////////////////////////////////////////////////////////
-#if defined(ARDUINO_ARCH_AVR)
-  math::Int16 m_output_left;
-  math::Int16 m_output_right;
-#else   // defined(ARDUINO_ARCH_AVR)
-  int16_t m_output_left;
-  int16_t m_output_right;
-#endif  // defined(ARDUINO_ARCH_AVR)
+  /// @brief Steps of the player tick, one per update() call.
+  enum TickStep : uint8_t {
+    TICK_STEP_BEGIN = 0,                                  // Count the tick, move to the next row.
+    TICK_STEP_NOTES = 1,                                  // Play the note of a channel.
+    TICK_STEP_CHANNELS = TICK_STEP_NOTES + NUM_CHANNELS,  // Tick a channel.
+    TICK_STEP_END = TICK_STEP_CHANNELS + NUM_CHANNELS,    // Pass the changes on.
+    TICK_STEP_NONE = 0xFFU                                // No tick in progress.
+  };
+
+  uint8_t m_tick_step;  // ∈ {TickStep}
+#endif
+
+#if !defined(ARDUINO_ARCH_AVR)
+  // Frequency dependent constants, shared by the samplers.
+  internal::Rate m_rate;
+#endif
+
+  //////////////////////////////////////////////////////////////////////////////
+  Mixer<Output> m_mixer;
+
+#if MOD8_OPTION_BUFFERED_OUTPUT
+  // Output ring buffer. Indices are free-running.
+  typename Mixer<Output>::BufferFrame m_buffer[config::OUTPUT_BUFFER_LENGTH];
+  volatile uint8_t m_buffer_read /* written from interrupt */;
+  volatile uint8_t m_buffer_write;
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT
 
-// TODO: Extract class Mixer?
 #if MOD8_PARAM_DOWNSAMPLING_FACTOR_LOG2 > 0
   uint8_t m_mixing_counter;
-#if MOD8_OPTION_DOWNSAMPLING_WITH_LERP
-  int16_t m_slope_left;
-  int16_t m_slope_right;
-#endif
 #endif
 
   Timer m_tick_timer;
 
+#if MOD8_PARAM_SFX_VOICES > 0
+  //////////////////////////////////////////////////////////////////////////////
+  struct SfxVoice {
+    Sampler sampler;
+    Sample sample;  // the sampler refers to it
+    uint8_t priority;
+  };
+
+  SfxVoice m_sfx_voices[config::SFX_VOICES];
+#endif
+
   //////////////////////////////////////////////////////////////////////////////
-  Song m_song_info;                          //
-  Sample m_samples[format::NUM_SAMPLES];     //
-  Channel m_channels[format::NUM_CHANNELS];  //
-                                             //
-  const format::Song *m_song_data;           // NOTE: PROGMEM
-  const format::Row *m_pattern_data;         // NOTE: PROGMEM
+  Song m_song_info;                       //
+#if MOD8_OPTION_SMALL_RAM
+  // The layout, or the song end and the offsets of the sample data from m_song_data.
+  const format::SongLayout *m_song_layout;  // NOTE: PROGMEM, nullptr if the header is parsed
+  memory::SampleAddress m_song_end;
+  uint16_t m_sample_offsets[Traits::NUM_SAMPLES];
+#else
+  Sample m_samples[Traits::NUM_SAMPLES];  //
+#endif
+  Channel m_channels[NUM_CHANNELS];       //
+                                          //
+  const format::Song *m_song_data;        // NOTE: PROGMEM
+  const Row *m_pattern_data;              // NOTE: PROGMEM
+
+#if MOD8_OPTION_PATTERN_CACHE
+  PatternCache<NUM_CHANNELS> m_pattern_cache;
+#elif MOD8_OPTION_EXTERNAL_STORAGE
+  RowPrefetcher<NUM_CHANNELS> m_row_prefetcher;
+#endif
 
   //////////////////////////////////////////////////////////////////////////////
-  struct {
+  struct SongState {
     Mode mode;              // ∈ {Mode}
     uint8_t loop_counter;   // ∈ [0; 1]
     uint8_t order;          // ∈ [0; NUM_ORDERS)
@@ -925,7 +2604,7 @@ private:
     uint8_t ticks_per_row;  // ∈ [1; MAX_TICKS_PER_ROW]
   } m_song_state;
 
-  struct {
+  struct PatternState {
     uint8_t loop_start_row;  // ∈ [0; NUM_ROWS)
     uint8_t loop_counter;    // ∈ [0; 15]
 
@@ -933,10 +2612,10 @@ private:
       loop_start_row = 0;
       loop_counter = 0;
     }
-  } m_pattern_state[format::NUM_CHANNELS];
+  } m_pattern_state[NUM_CHANNELS];
 
   //////////////////////////////////////////////////////////////////////////////
-  struct {
+  struct RowState {
     uint8_t tick;   // ∈ [0; MAX_TICKS_PER_ROW]
     uint8_t delay;  // ∈ [0; 15]
   } m_row_state;
@@ -949,23 +2628,154 @@ private:
     ACTION_PATTERN_BREAK = 8U,
   };
 
-  struct {
+  struct RowActions {
     uint8_t actions;        // ∈ {Action}
     uint8_t jump_to_order;  // ∈ [0; NUM_ORDERS)
     uint8_t jump_to_row;    // ∈ [0; NUM_ROWS)
   } m_row_actions;
 
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Everything that decides which row is fetched next.
+  struct FlowState {
+    SongState song_state;
+    PatternState pattern_state[NUM_CHANNELS];
+    RowActions row_actions;
+  };
+
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_get_flow_state(FlowState &state) const {
+    state.song_state = m_song_state;
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      state.pattern_state[i] = m_pattern_state[i];
+    }
+    state.row_actions = m_row_actions;
+  }
+
+#if MOD8_OPTION_CHECKPOINTS
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  struct Checkpoint {
+    SongState song_state;
+    PatternState pattern_state[NUM_CHANNELS];
+    RowState row_state;
+    RowActions row_actions;
+    uint8_t active_mask;
+    uint8_t max_bpm;
+    uint32_t playback_duration;
+    Mixer<Output> mixer;
+
+    // Raw copies of the non-copyable objects.
+    uint8_t tick_timer[sizeof(Timer)];
+    uint8_t channels[NUM_CHANNELS][sizeof(Channel)];
+  };
+
+  // Copying is deleted only to catch mistakes, the objects have no owned resources.
+  static_assert(MOD8_INTERNAL_IS_TRIVIALLY_COPYABLE(Timer), "Timer can't be copied into a checkpoint");
+  static_assert(MOD8_INTERNAL_IS_TRIVIALLY_COPYABLE(Channel), "Channel can't be copied into a checkpoint");
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_add_checkpoint() {
+    if (m_checkpoint_count == m_checkpoint_capacity) {
+      return;
+    }
+
+    Checkpoint &checkpoint = m_checkpoints[m_checkpoint_count++];
+
+    checkpoint.song_state = m_song_state;
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      checkpoint.pattern_state[i] = m_pattern_state[i];
+    }
+    checkpoint.row_state = m_row_state;
+    checkpoint.row_actions = m_row_actions;
+    checkpoint.active_mask = m_active_mask;
+    checkpoint.max_bpm = m_stats.max_bpm;
+    checkpoint.playback_duration = m_stats.playback_duration;
+    checkpoint.mixer = m_mixer;
+
+    memcpy(checkpoint.tick_timer, static_cast<const void *>(&m_tick_timer), sizeof(Timer));
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      memcpy(checkpoint.channels[i], static_cast<const void *>(&m_channels[i]), sizeof(Channel));
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Restore the last checkpoint at or before the order. Keeps the mode.
+  /// Orders are entered in ascending order until the song jumps back, so the
+  /// checkpoint precedes any row of the order.
+  /// @return false if there is no such checkpoint.
+  //////////////////////////////////////////////////////////////////////////////
+  bool internal_restore_checkpoint(uint8_t order) {
+    const Checkpoint *checkpoint = nullptr;
+
+    for (uint8_t i = 0; i != m_checkpoint_count && m_checkpoints[i].song_state.order <= order; ++i) {
+      checkpoint = &m_checkpoints[i];
+    }
+
+    if (checkpoint == nullptr) {
+      return false;
+    }
+
+    const Mode mode = m_song_state.mode;
+
+    m_song_state = checkpoint->song_state;
+    m_song_state.mode = mode;
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      m_pattern_state[i] = checkpoint->pattern_state[i];
+    }
+    m_row_state = checkpoint->row_state;
+    m_row_actions = checkpoint->row_actions;
+    m_stats.max_bpm = checkpoint->max_bpm;
+    m_stats.playback_duration = checkpoint->playback_duration;
+    m_mixer = checkpoint->mixer;
+
+    memcpy(static_cast<void *>(&m_tick_timer), checkpoint->tick_timer, sizeof(Timer));
+    for (uint8_t i = 0; i != NUM_CHANNELS; ++i) {
+      memcpy(static_cast<void *>(&m_channels[i]), checkpoint->channels[i], sizeof(Channel));
+    }
+
+    m_active_mask = checkpoint->active_mask;
+
+#if MOD8_OPTION_PATTERN_CACHE
+    m_pattern_cache.reset(reinterpret_cast<const Pattern *>(m_song_data + 1),
+                          m_song_info.pattern_count);
+#endif
+
+    fetch_pattern();
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  Checkpoint *m_checkpoints;
+  uint8_t m_checkpoint_capacity;
+  uint8_t m_checkpoint_count;
+#endif  // MOD8_OPTION_CHECKPOINTS
+
   //////////////////////////////////////////////////////////////////////////////
   Stats m_stats;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Player for any song.
+////////////////////////////////////////////////////////////////////////////////
+using Player = BasicPlayer<DefaultSongTraits>;
+
 namespace internal {
 
 #if defined(ARDUINO_ARCH_AVR)
 
 constexpr uint16_t SIZE_OF_CHANNEL = sizeof(Channel);
 MOD8_INTERNAL_CONSTEXPR_PRINT(SIZE_OF_CHANNEL);
-static_assert(SIZE_OF_CHANNEL == 57, "Size of class Channel was changed!");
+constexpr uint16_t SIZE_OF_SONG_INFO = sizeof(Song);
+MOD8_INTERNAL_CONSTEXPR_PRINT(SIZE_OF_SONG_INFO);
+
+// With MOD8_OPTION_SMALL_RAM, the channel keeps two copies of a sample descriptor instead of two pointers,
+// and the effect state is packed.
+constexpr uint16_t EXPECTED_SIZE_OF_CHANNEL = MOD8_OPTION_SMALL_RAM ? 23U + 2U * SIZE_OF_SAMPLE : 33U;
+constexpr uint16_t EXPECTED_SIZE_OF_SONG_INFO = MOD8_OPTION_SMALL_RAM ? 2U : 38U;
+
+static_assert(SIZE_OF_CHANNEL == EXPECTED_SIZE_OF_CHANNEL + SIZE_OF_SAMPLER, "Size of class Channel was changed!");
+static_assert(SIZE_OF_SONG_INFO == EXPECTED_SIZE_OF_SONG_INFO, "Size of struct Song was changed!");
 
 #endif  // defined(ARDUINO_ARCH_AVR)
 
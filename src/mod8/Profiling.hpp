@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+
+namespace mod8 {
+
+namespace profiling {
+
+////////////////////////////////////////////////////////////////////////////////
+#if defined(ARDUINO)
+using Clock = uint16_t;
+using ClockSum = uint32_t;
+#else   // defined(ARDUINO)
+using Clock = uint32_t;
+using ClockSum = uint64_t;
+#endif  // defined(ARDUINO)
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Current value of a free-running hardware counter.
+/// Must be defined by the user application if MOD8_OPTION_PROFILING is enabled.
+/// Called from interrupt.
+////////////////////////////////////////////////////////////////////////////////
+Clock read_clock();
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Cost statistics of a code section, in clock counter units.
+////////////////////////////////////////////////////////////////////////////////
+struct Cost {
+  Clock min;
+  Clock max;
+  Clock avg;  // Over the last complete window of AVG_WINDOW measurements.
+
+  // Current window
+  ClockSum sum;
+  uint8_t count;
+
+  static constexpr uint8_t AVG_WINDOW_LOG2 = 8;
+
+  //////////////////////////////////////////////////////////////////////////////
+  void reset() {
+    min = static_cast<Clock>(~Clock{ 0 });
+    max = avg = 0;
+    sum = 0;
+    count = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void add(Clock cost) {
+    if (cost < min) {
+      min = cost;
+    }
+
+    if (cost > max) {
+      max = cost;
+    }
+
+    sum += cost;
+
+    // The 8-bit counter wraps after 2^AVG_WINDOW_LOG2 measurements.
+    if (++count == 0) {
+      avg = static_cast<Clock>(sum >> AVG_WINDOW_LOG2);
+      sum = 0;
+    }
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Measures the cost of the enclosing scope.
+////////////////////////////////////////////////////////////////////////////////
+class Probe {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE explicit Probe(Cost &cost)
+    : m_cost(cost)
+    , m_begin(read_clock()) {
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE ~Probe() {
+    m_cost.add(static_cast<Clock>(read_clock() - m_begin));
+  }
+
+  Probe(const Probe &) = delete;
+  Probe &operator=(const Probe &) = delete;
+  Probe(Probe &&) = delete;
+  Probe &operator=(Probe &&) = delete;
+
+private:
+  Cost &m_cost;
+  const Clock m_begin;
+};
+
+}  // namespace profiling
+
+}  // namespace mod8
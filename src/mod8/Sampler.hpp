@@ -46,14 +46,37 @@ namespace internal {
 constexpr uint64_t PLAYER_SPEED_CONSTANT = math::make_fixp_fraction<uint32_t, 14>(
   config::AMIGA_PAULA_CLOCK_FREQ, config::SAMPLING_FREQ);  // fixed-point X.14
 
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Finetune correction factors.
+/// Values are fixed-point 2.14 numbers, index is the same as in SPEED_TABLE.
+////////////////////////////////////////////////////////////////////////////////
+constexpr uint16_t FINETUNE_FACTORS[format::NUM_FINETUNES]{
+  math::make_fixp<uint16_t, 14>(1U, 0U),      // =¢0
+  math::make_fixp<uint16_t, 14>(1U, 118U),    // +¢12,5
+  math::make_fixp<uint16_t, 14>(1U, 238U),    // +¢25,0
+  math::make_fixp<uint16_t, 14>(1U, 358U),    // +¢37,5
+  math::make_fixp<uint16_t, 14>(1U, 480U),    // +¢50,0
+  math::make_fixp<uint16_t, 14>(1U, 602U),    // +¢62,5
+  math::make_fixp<uint16_t, 14>(1U, 725U),    // +¢75,0
+  math::make_fixp<uint16_t, 14>(1U, 849U),    // +¢87,5
+  math::make_fixp<uint16_t, 14>(0U, 15464U),  // -¢100,0
+  math::make_fixp<uint16_t, 14>(0U, 15576U),  // -¢87,5
+  math::make_fixp<uint16_t, 14>(0U, 15689U),  // -¢75,0
+  math::make_fixp<uint16_t, 14>(0U, 15803U),  // -¢62,5
+  math::make_fixp<uint16_t, 14>(0U, 15917U),  // -¢50,0
+  math::make_fixp<uint16_t, 14>(0U, 16032U),  // -¢37,5
+  math::make_fixp<uint16_t, 14>(0U, 16149U),  // -¢25,0
+  math::make_fixp<uint16_t, 14>(0U, 16266U)   // -¢12,5
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Multiplies the base sample speed by the finetune correction factor.
-/// @param num integer part of the correction factor
-/// @param den fractional part of the correction factor (in 1/16384 units).
+/// @param speed_constant fixed-point X.14 base speed, PLAYER_SPEED_CONSTANT for the configured frequency.
+/// @param finetune ∈ [0; 15] index of the correction factor.
 ////////////////////////////////////////////////////////////////////////////////
-constexpr uint32_t calc_speed(uint16_t intgr, uint16_t fract) {
+constexpr uint32_t calc_speed(uint64_t speed_constant, uint8_t finetune) {
   // 18.14 x 2.14 / 2^14 = 18.14
-  return PLAYER_SPEED_CONSTANT * math::make_fixp<uint16_t, 14>(intgr, fract) / 16384U;
+  return static_cast<uint32_t>(speed_constant * FINETUNE_FACTORS[finetune] / 16384U);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -64,22 +87,14 @@ constexpr uint32_t calc_speed(uint16_t intgr, uint16_t fract) {
 /// Finetune: 0  +1  +2  +3  +4  +5  +6  +7  -8  -7  -6  -5  -4  -3  -2  -1
 ////////////////////////////////////////////////////////////////////////////////
 constexpr uint32_t SPEED_TABLE[format::NUM_FINETUNES] MOD8_ATTR_CONST_ARRAY{
-  calc_speed(1U, 0U),      // =¢0
-  calc_speed(1U, 118U),    // +¢12,5
-  calc_speed(1U, 238U),    // +¢25,0
-  calc_speed(1U, 358U),    // +¢37,5
-  calc_speed(1U, 480U),    // +¢50,0
-  calc_speed(1U, 602U),    // +¢62,5
-  calc_speed(1U, 725U),    // +¢75,0
-  calc_speed(1U, 849U),    // +¢87,5
-  calc_speed(0U, 15464U),  // -¢100,0
-  calc_speed(0U, 15576U),  // -¢87,5
-  calc_speed(0U, 15689U),  // -¢75,0
-  calc_speed(0U, 15803U),  // -¢62,5
-  calc_speed(0U, 15917U),  // -¢50,0
-  calc_speed(0U, 16032U),  // -¢37,5
-  calc_speed(0U, 16149U),  // -¢25,0
-  calc_speed(0U, 16266U)   // -¢12,5
+  calc_speed(PLAYER_SPEED_CONSTANT, 0U),  calc_speed(PLAYER_SPEED_CONSTANT, 1U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 2U),  calc_speed(PLAYER_SPEED_CONSTANT, 3U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 4U),  calc_speed(PLAYER_SPEED_CONSTANT, 5U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 6U),  calc_speed(PLAYER_SPEED_CONSTANT, 7U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 8U),  calc_speed(PLAYER_SPEED_CONSTANT, 9U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 10U), calc_speed(PLAYER_SPEED_CONSTANT, 11U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 12U), calc_speed(PLAYER_SPEED_CONSTANT, 13U),
+  calc_speed(PLAYER_SPEED_CONSTANT, 14U), calc_speed(PLAYER_SPEED_CONSTANT, 15U)
 };
 
 constexpr unsigned MAX_SPEED_INDEX = 7;
@@ -100,24 +115,242 @@ MOD8_INTERNAL_CONSTEXPR_PRINT(PLAYER_SPEED_CONSTANT);
 MOD8_INTERNAL_CONSTEXPR_PRINT(MAX_SPEED);
 MOD8_INTERNAL_CONSTEXPR_PRINT(MIN_LOOP_LENGTH);
 
+#if MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Reciprocals of periods, to make a division by the period cheap.
+/// Covers the standard Protracker period range only, all 16 finetunes share it.
+/// With high downsampling factors the top periods, whose speed doesn't fit 16 bits, are left out.
+/// Values are fixed-point 0.22 numbers: 2^22 / period.
+////////////////////////////////////////////////////////////////////////////////
+constexpr uint8_t RECIPROCAL_FRACTIONAL_BITS = 22;
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Shortest period, whose speed fits 16 bits.
+/// @param max_speed fixed-point 18.14 speed with the highest finetune.
+////////////////////////////////////////////////////////////////////////////////
+constexpr uint16_t calc_reciprocal_min_period(uint32_t max_speed) {
+  return max_speed / 0xffffU + 1U > format::AMIGA_MIN_PERIOD ? static_cast<uint16_t>(max_speed / 0xffffU + 1U)
+                                                             : format::AMIGA_MIN_PERIOD;
+}
+
+constexpr uint16_t RECIPROCAL_MIN_PERIOD = calc_reciprocal_min_period(MAX_SPEED);
+constexpr uint16_t RECIPROCAL_MAX_PERIOD = format::AMIGA_MAX_PERIOD;
+constexpr uint16_t RECIPROCAL_TABLE_LENGTH = RECIPROCAL_MAX_PERIOD - RECIPROCAL_MIN_PERIOD + 1U;
+
+constexpr uint16_t calc_reciprocal(uint16_t period) {
+  return static_cast<uint16_t>((1UL << RECIPROCAL_FRACTIONAL_BITS) / period);
+}
+
+static_assert((1UL << RECIPROCAL_FRACTIONAL_BITS) / RECIPROCAL_MIN_PERIOD <= 0xffffU,
+              "Reciprocal of period doesn't fit 16 bits");
+static_assert(MAX_SPEED / RECIPROCAL_MIN_PERIOD <= 0xffffU, "Speed doesn't fit 16 bits");
+
+template<typename INDICES>
+struct ReciprocalTable;
+
+template<uint16_t... INDICES>
+struct ReciprocalTable<math::IndexSequence<INDICES...>> {
+  static constexpr uint16_t values[sizeof...(INDICES)] MOD8_ATTR_CONST_ARRAY{
+    calc_reciprocal(RECIPROCAL_MIN_PERIOD + INDICES)...
+  };
+};
+
+template<uint16_t... INDICES>
+constexpr uint16_t ReciprocalTable<math::IndexSequence<INDICES...>>::values[sizeof...(INDICES)];
+
+using PeriodReciprocals = ReciprocalTable<math::MakeIndexSequence<RECIPROCAL_TABLE_LENGTH>::type>;
+
+static_assert(PeriodReciprocals::values[0] == 37117U || RECIPROCAL_MIN_PERIOD != 113U, "Test failed: PeriodReciprocals");
+static_assert(PeriodReciprocals::values[RECIPROCAL_TABLE_LENGTH - 1U] == 4899U,
+              "Test failed: PeriodReciprocals");
+
+#endif  // MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+
+#if !defined(ARDUINO_ARCH_AVR)
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief The frequency dependent constants, calculated at run time for the mixing frequency
+/// given to BasicPlayer::init(uint32_t), so one host build renders at any rate.
+/// With config::MIXING_FREQ the values are equal to the compile-time ones.
+////////////////////////////////////////////////////////////////////////////////
+struct Rate {
+  uint32_t mixing_freq;                    // in Hertz
+  uint32_t sampling_freq;                  // config::SAMPLING_FREQ
+  uint32_t speeds[format::NUM_FINETUNES];  // SPEED_TABLE
+  uint16_t min_loop_length;                // MIN_LOOP_LENGTH
+  uint16_t samples_per_vblank;             // config::SAMPLES_PER_AMIGA_VBLANK
+#if MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+  uint16_t reciprocal_min_period;          // RECIPROCAL_MIN_PERIOD, the table doesn't go below it
+#endif
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Calculate the constants.
+  /// @param freq mixing frequency in Hertz.
+  /// @return false if a tick at the slowest tempo doesn't fit 16 bits of frames, or is shorter than a frame.
+  /// The values are left unchanged then.
+  //////////////////////////////////////////////////////////////////////////////
+  bool init(uint32_t freq) {
+    const uint32_t sampling = freq / config::DOWNSAMPLING_FACTOR;
+
+    // TIMER_PERIOD = SAMPLING_FREQ * 5 / (2 * 32), see OPCODE_SET_SPEED.
+    if (sampling < config::AMIGA_VBLANK_INT_FREQ || 5UL * sampling / 32U / 2U > 0xffffU) {
+      return false;
+    }
+
+    const uint64_t speed_constant = math::make_fixp_fraction<uint32_t, 14>(
+      config::AMIGA_PAULA_CLOCK_FREQ, sampling);
+
+    for (uint8_t finetune = 0; finetune != format::NUM_FINETUNES; ++finetune) {
+      speeds[finetune] = calc_speed(speed_constant, finetune);
+    }
+
+    mixing_freq = freq;
+    sampling_freq = sampling;
+    min_loop_length = static_cast<uint16_t>(speeds[MAX_SPEED_INDEX] / format::MIN_PERIOD / 16384U) + 1U;
+    samples_per_vblank = static_cast<uint16_t>(sampling / config::AMIGA_VBLANK_INT_FREQ);
+#if MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+    reciprocal_min_period = math::maximum(calc_reciprocal_min_period(speeds[MAX_SPEED_INDEX]),
+                                          RECIPROCAL_MIN_PERIOD);
+#endif
+    return true;
+  }
+};
+
+#endif  // !defined(ARDUINO_ARCH_AVR)
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Calc playback speed.
+/// Gives exactly the same result as the plain division, but usually without it.
+/// @param speed_constant fixed-point 18.14 speed from SPEED_TABLE.
+/// @param period ∈ [MIN_PERIOD; MAX_PERIOD]
+/// @param min_period shortest period to look up, not below RECIPROCAL_MIN_PERIOD.
+/// @return fixed-point 2.14
+////////////////////////////////////////////////////////////////////////////////
+#if MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+MOD8_ATTR_INLINE uint16_t calc_period_speed(uint32_t speed_constant,
+                                            uint16_t period,
+                                            uint16_t min_period = RECIPROCAL_MIN_PERIOD) {
+  using memory::read_table_word;
+
+  if (period >= min_period && period <= RECIPROCAL_MAX_PERIOD) {
+    const uint16_t reciprocal = read_table_word(
+      PeriodReciprocals::values + (period - RECIPROCAL_MIN_PERIOD));
+
+    // (speed_constant * reciprocal) >> 22, built of 16x16 bit multiplications.
+    const auto hi = static_cast<uint16_t>(speed_constant >> 16U);
+    const auto lo = static_cast<uint16_t>(speed_constant);
+    auto speed = static_cast<uint16_t>(
+      (static_cast<uint32_t>(hi) * reciprocal
+       + ((static_cast<uint32_t>(lo) * reciprocal) >> 16U))
+      >> (RECIPROCAL_FRACTIONAL_BITS - 16U));
+
+    // The truncated reciprocal makes the estimate a bit lower. Fix it.
+    uint32_t remainder = speed_constant - static_cast<uint32_t>(speed) * period;
+    while (remainder >= period) {
+      remainder -= period;
+      ++speed;
+    }
+
+    return speed;
+  }
+
+  return static_cast<uint16_t>(speed_constant / period);
+}
+#else   // MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+MOD8_ATTR_INLINE uint16_t calc_period_speed(uint32_t speed_constant, uint16_t period) {
+  return static_cast<uint16_t>(speed_constant / period);
+}
+#endif  // MOD8_OPTION_PERIOD_RECIPROCAL_TABLE
+
 }  // namespace internal
 
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Sample data to play.
 ////////////////////////////////////////////////////////////////////////////////
 struct Sample {
-  const uint8_t *begin;       // PROGMEM
-  const uint8_t *end;         // PROGMEM
-  const uint8_t *loop_begin;  // PROGMEM
-  const uint8_t *loop_end;    // PROGMEM
-  uint8_t finetune;           // ∈ [0; MAX_FINETUNE]
-  int8_t volume;              // ∈ [0; MAX_VOLUME]
+  memory::SampleAddress begin;       // PROGMEM
+  memory::SampleAddress end;         // PROGMEM
+  memory::SampleAddress loop_begin;  // PROGMEM
+  memory::SampleAddress loop_end;    // PROGMEM
+  uint8_t finetune;                  // ∈ [0; MAX_FINETUNE]
+  int8_t volume;                     // ∈ [0; MAX_VOLUME]
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+  bool compressed;                   // begin points to the delta table then
+  uint8_t loop_delta_sum;            // sum of the deltas before the loop begin
+#endif
 };
 
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+namespace internal {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Whether the sample data starts with format::DELTA4_SIGNATURE.
+////////////////////////////////////////////////////////////////////////////////
+inline bool is_delta4(memory::SampleAddress data, memory::SampleAddress data_end) {
+  using memory::read_sample_byte;
+
+  if (data + format::DELTA4_SIGNATURE_LENGTH > data_end) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i != format::DELTA4_SIGNATURE_LENGTH; ++i) {
+    if (read_sample_byte(data + i) != format::DELTA4_SIGNATURE[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Delta of the compressed sample at the position.
+/// @param table PROGMEM address of the delta table.
+/// @param codes offset of the delta indices from the table.
+////////////////////////////////////////////////////////////////////////////////
+MOD8_ATTR_INLINE uint8_t get_delta4(memory::SampleAddress table, uint16_t codes, uint16_t position) {
+  using memory::read_sample_byte;
+
+  const uint8_t code = read_sample_byte(table + codes + (position >> 1U));
+  return read_sample_byte(table + ((position & 1U) ? (code >> 4U) : (code & 0xFU)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Sum of the deltas of the compressed sample before the position.
+/// Decodes up to DELTA4_BLOCK_LENGTH - 1 deltas from the seed of the block.
+/// @param table PROGMEM address of the delta table.
+/// @param codes offset of the delta indices from the table.
+////////////////////////////////////////////////////////////////////////////////
+inline uint8_t get_delta4_sum(memory::SampleAddress table, uint16_t codes, uint16_t position) {
+  using memory::read_sample_byte;
+
+  const uint16_t block = position / format::DELTA4_BLOCK_LENGTH;
+  uint8_t sum = read_sample_byte(table + format::DELTA4_TABLE_LENGTH + block);
+
+  for (uint16_t i = block * format::DELTA4_BLOCK_LENGTH; i != position; ++i) {
+    sum += get_delta4(table, codes, i);
+  }
+
+  return sum;
+}
+
+}  // namespace internal
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+
+#if !defined(ARDUINO_ARCH_AVR)
+template <uint8_t NUM_LANES>
+class VoiceBank;
+#endif  // !defined(ARDUINO_ARCH_AVR)
+
 ////////////////////////////////////////////////////////////////////////////////
 /// @brief Sample player.
 ////////////////////////////////////////////////////////////////////////////////
 class Sampler {
+#if !defined(ARDUINO_ARCH_AVR)
+  template <uint8_t NUM_LANES>
+  friend class VoiceBank;
+#endif  // !defined(ARDUINO_ARCH_AVR)
+
 public:
   //////////////////////////////////////////////////////////////////////////////
   //@{
@@ -135,6 +368,23 @@ public:
   //@}
   //////////////////////////////////////////////////////////////////////////////
 
+#if MOD8_OPTION_COMMAND_QUEUE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Changes of the sampler, made by update() and applied by the interrupt.
+  //////////////////////////////////////////////////////////////////////////////
+  struct Command {
+    const Sample *sample;   // COMMAND_RETRIG only
+    uint16_t speed;         // fixed-point 2.14, COMMAND_PERIOD only
+    uint8_t sample_offset;  // COMMAND_RETRIG only
+    int8_t volume;          // COMMAND_RETRIG or COMMAND_VOLUME
+    uint8_t actions;        // COMMAND_* bits
+  };
+
+  static constexpr uint8_t COMMAND_RETRIG = 1U << 0U;
+  static constexpr uint8_t COMMAND_VOLUME = 1U << 1U;
+  static constexpr uint8_t COMMAND_PERIOD = 1U << 2U;
+#endif  // MOD8_OPTION_COMMAND_QUEUE
+
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Initialize.
   /// Initializes the smallest possible subset of variables.
@@ -146,8 +396,21 @@ public:
     m_sample = 0;
     m_cached_period = 0;
     m_cached_finetune = 0;
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command.actions = 0;
+#endif
   }
 
+#if !defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Set the frequency dependent constants.
+  /// Must be called before the first note, init() and reset() keep them.
+  //////////////////////////////////////////////////////////////////////////////
+  void set_rate(const internal::Rate *rate) {
+    m_rate = rate;
+  }
+#endif
+
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Return to initial state.
   //////////////////////////////////////////////////////////////////////////////
@@ -169,6 +432,21 @@ public:
   /// @param volume ∈ [0; MAX_VOLUME] playback volume.
   //////////////////////////////////////////////////////////////////////////////
   void retrig(const Sample *sample, uint16_t period, uint8_t sample_offset, int8_t volume) {
+#if MOD8_OPTION_COMMAND_QUEUE
+    // Same as reset(), but for the cache only: the interrupt resets the rest in apply().
+    m_cached_period = 0;
+    m_cached_finetune = 0;
+
+    m_command.actions = COMMAND_RETRIG;
+    m_command.sample = sample;
+    m_command.sample_offset = sample_offset;
+    set_volume(volume);
+
+    if (sample != nullptr && sample->begin != sample->end) {
+      m_finetune = sample->finetune;
+      internal_set_period(period);
+    }
+#else   // MOD8_OPTION_COMMAND_QUEUE
     reset();
     set_volume(volume);
 
@@ -185,16 +463,85 @@ public:
     // Update period.
     m_finetune = sample->finetune;
     internal_set_period(period);
+    internal_start(sample, sample_offset);
+#endif  // MOD8_OPTION_COMMAND_QUEUE
+  }
+
+#if MOD8_OPTION_COMMAND_QUEUE
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Take the changes made since the last call.
+  /// @return false if there are none.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool take_command(Command &command) {
+    if (m_command.actions == 0) {
+      return false;
+    }
+
+    command = m_command;
+    m_command.actions = 0;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Apply the changes taken by take_command().
+  /// Called from interrupt, unless the player is stopped: the interrupt doesn't preempt itself,
+  /// so no handshake with fetch_sample() is needed.
+  //////////////////////////////////////////////////////////////////////////////
+  void apply(const Command &command) /* called from interrupt */ {
+    const uint8_t actions = command.actions;
+
+    if (actions & COMMAND_RETRIG) {
+      m_active = false;
+      m_sample = 0;
+    }
+
+    if (actions & (COMMAND_RETRIG | COMMAND_VOLUME)) {
+      m_volume = command.volume;
+    }
+
+    if (actions & COMMAND_PERIOD) {
+      internal_set_speed(command.speed);
+
+      // The period of an empty sample isn't set.
+      if (actions & COMMAND_RETRIG) {
+        internal_start(command.sample, command.sample_offset);
+      }
+    }
+  }
+#endif  // MOD8_OPTION_COMMAND_QUEUE
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Start sampling with the period set.
+  /// @param sample non-empty sample to play.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_start(const Sample *sample, uint8_t sample_offset) {
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    m_compressed = sample->compressed;
+    m_loop_delta_sum = sample->loop_delta_sum;
+    m_codes = format::DELTA4_TABLE_LENGTH
+            + format::get_delta4_seed_count(static_cast<uint16_t>(sample->end - sample->begin));
+#endif
 
 #if defined(ARDUINO_ARCH_AVR)
     static_assert(sizeof(void *) == 2, "Only 16-bit pointers are supported");
 
     // Sample data boundaries.
+#if MOD8_INTERNAL_SAMPLE_OFFSETS
+    // Offsets from the address of the sample.
+    m_sample_base = sample->begin;
+    m_phase.w32.w1 = 0;
+    m_phase.w32.w0 = 0;
+    m_end = static_cast<uint16_t>(sample->end - sample->begin);
+    m_loop_begin = static_cast<uint16_t>(sample->loop_begin - sample->begin);
+    m_loop_end = static_cast<uint16_t>(sample->loop_end - sample->begin);
+#else   // MOD8_INTERNAL_SAMPLE_OFFSETS
     m_phase.w32.w1 = reinterpret_cast< uint16_t >(sample->begin);
     m_phase.w32.w0 = 0;
     m_end = reinterpret_cast< uint16_t >(sample->end);
     m_loop_begin = reinterpret_cast< uint16_t >(sample->loop_begin);
     m_loop_end = reinterpret_cast< uint16_t >(sample->loop_end);
+#endif  // MOD8_INTERNAL_SAMPLE_OFFSETS
 
     // If the looped section is too short, don't play it.
     // Correct handling of short loops requires too many CPU clocks.
@@ -218,6 +565,14 @@ public:
       }
     }
 
+#if MOD8_OPTION_EXTERNAL_STORAGE
+    internal_read_ahead(m_phase.w32.w1);
+#endif
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    internal_seek_delta(m_phase.w32.w1);
+#endif
+
 #else  // defined(ARDUINO_ARCH_AVR)
     static_assert(sizeof(intptr_t) >= 4, "Unsupported size of pointer");
 
@@ -230,7 +585,7 @@ public:
 
     // If the looped section is too short, don't play it.
     // Correct handling of short loops requires too many CPU clocks.
-    if (m_loop_end - m_loop_begin < internal::MIN_LOOP_LENGTH) {
+    if (m_loop_end - m_loop_begin < m_rate->min_loop_length) {
       m_loopless = true;
       m_loop_end = m_loop_begin + 1U;
     } else {
@@ -252,17 +607,33 @@ public:
     m_loop_begin = math::make_fixp<intptr_t, 16>(m_loop_begin, 0);
     m_loop_end = math::make_fixp<intptr_t, 16>(m_loop_end, 0);
 
+#if MOD8_OPTION_EXTERNAL_STORAGE
+    internal_read_ahead(static_cast<uint16_t>(m_phase >> 16));
+#endif
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    internal_seek_delta(static_cast<uint16_t>(m_phase >> 16));
+#endif
+
 #endif  // defined(ARDUINO_ARCH_AVR)
 
+    // Activate only after the state was written.
+    memory::barrier();
     m_active = true;
   }
 
+public:
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Set volume.
   /// @param volume ∈ [0; MAX_VOLUME]
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE void set_volume(int8_t volume) {
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command.volume = volume >> config::VOLUME_ATTENNUATION_LOG2;
+    m_command.actions |= COMMAND_VOLUME;
+#else   // MOD8_OPTION_COMMAND_QUEUE
     m_volume = volume >> config::VOLUME_ATTENNUATION_LOG2;
+#endif  // MOD8_OPTION_COMMAND_QUEUE
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -275,15 +646,23 @@ public:
     }
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Check if the sampler produces non-silent output.
+  /// An inactive sampler always outputs 0.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE bool is_active() const {
+    return m_active;
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Fetch next sample.
   /// Time-critical routine. Called from interrupt.
   /// Estimated max. duration: 86 CPU clocks on ATmega328.
   //////////////////////////////////////////////////////////////////////////////
   MOD8_ATTR_INLINE void fetch_sample() /* called from interrupt */ {
-    using math::u8_to_s8;
-    using memory::read_song_byte;
-
+#if MOD8_OPTION_ASM_MIXER && defined(ARDUINO_ARCH_AVR)
+    internal_fetch_sample_asm();
+#else   // MOD8_OPTION_ASM_MIXER && defined(ARDUINO_ARCH_AVR)
     // ■■■■■■■■■■■■■
     // ■  5 clocks ■
     // ■■■■■■■■■■■■■
@@ -301,8 +680,8 @@ public:
     // ■ 16 clocks ■
     // ■■■■■■■■■■■■■
     // sample ∈ [-128; 127]
-    const int8_t sample = u8_to_s8(
-      read_song_byte(reinterpret_cast<const uint8_t *>(m_phase.w32.w1)));
+    const uint16_t position = m_phase.w32.w1;
+    const int8_t sample = internal_read_sample(position);
     // m_volume ∈ [0; 64]
     // m_sample ∈ [-8192; 8128]
     m_sample = sample * m_volume;
@@ -322,6 +701,11 @@ public:
       if (!m_loopless) {
         m_phase.w32.w1 -= (m_end - m_loop_begin);
       } else {
+        // A one-shot sample stuck on silence will never sound again.
+        if (sample == 0 && position == m_loop_begin) {
+          m_active = false;
+        }
+
         m_phase.w32.w1 = m_loop_begin;
       }
 
@@ -332,10 +716,15 @@ public:
     }
 #else   // defined(ARDUINO_ARCH_AVR)
     // sample ∈ [-128; 127]
-    const int8_t sample = u8_to_s8(read_song_byte(m_sample_base + (m_phase >> 16)));
+    const intptr_t position = m_phase >> 16;
+    const int8_t sample = internal_read_sample(static_cast<uint16_t>(position));
     // m_volume ∈ [0; 64]
     // m_sample ∈ [-8192; 8128]
+#if MOD8_OPTION_INTERPOLATION
+    m_sample = m_volume * internal_interpolate(position, sample);
+#else
     m_sample = m_volume * sample;
+#endif
 
     m_phase += m_phase_increment;
 
@@ -343,6 +732,11 @@ public:
       if (!m_loopless) {
         m_phase -= (m_end - m_loop_begin);
       } else {
+        // A one-shot sample stuck on silence will never sound again.
+        if (sample == 0 && position == (m_loop_begin >> 16)) {
+          m_active = false;
+        }
+
         m_phase = m_loop_begin;
       }
 
@@ -354,6 +748,91 @@ public:
     // ■  2 clocks ■
     // ■■■■■■■■■■■■■
     m_sampling = false;
+#endif  // MOD8_OPTION_ASM_MIXER && defined(ARDUINO_ARCH_AVR)
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Do the same as `count` calls of fetch_sample(), without reading every sample.
+  /// Loops are longer than the increment, so the phase after the wraparounds is calculated.
+  /// @param count ∈ [0; frames of one player tick], so that count * increment fits into 32 bits.
+  /// @note Not reentrant with fetch_sample().
+  //////////////////////////////////////////////////////////////////////////////
+  void skip(uint16_t count) {
+    if (!m_active || count == 0) {
+      return;
+    }
+
+#if defined(ARDUINO_ARCH_AVR)
+    uint32_t phase = m_phase.u32;
+    const uint32_t end = static_cast<uint32_t>(m_end) << 16U;
+    const uint32_t loop_begin = static_cast<uint32_t>(m_loop_begin) << 16U;
+    const uint32_t loop_end = static_cast<uint32_t>(m_loop_end) << 16U;
+    const uint32_t increment = m_phase_increment.u32;
+#else   // defined(ARDUINO_ARCH_AVR)
+    uint32_t phase = static_cast<uint32_t>(m_phase);
+    const uint32_t end = static_cast<uint32_t>(m_end);
+    const uint32_t loop_begin = static_cast<uint32_t>(m_loop_begin);
+    const uint32_t loop_end = static_cast<uint32_t>(m_loop_end);
+    const uint32_t increment = static_cast<uint32_t>(m_phase_increment);
+#endif  // defined(ARDUINO_ARCH_AVR)
+
+    // The last frame is fetched for real to set the output sample.
+    uint32_t frames = count - 1U;
+
+    // Frames up to the first wraparound, inclusive.
+    const uint32_t head = phase < end ? (end - phase - 1U) / increment + 1U : 1U;
+
+    if (frames < head) {
+      phase += frames * increment;
+    } else {
+      const uint32_t position = (phase + (head - 1U) * increment) >> 16U;
+      frames -= head;
+
+      if (!m_loopless) {
+        const uint32_t length = loop_end - loop_begin;
+
+        // Offset in the loop after the first wraparound.
+        uint32_t offset = phase < end ? head * increment - (end - phase) : increment + (phase - end);
+        offset %= length;
+
+        // Every next wraparound subtracts the loop length.
+        const uint32_t step = frames * increment % length;
+        offset = offset >= length - step ? offset - (length - step) : offset + step;
+
+        phase = loop_begin + offset;
+      } else {
+        // A one-shot sample stuck on silence will never sound again.
+        // After the first wraparound, the loop begin is the only position to read.
+        const uint16_t first = static_cast<uint16_t>(loop_begin >> 16U);
+        const uint32_t cycle = (loop_end - loop_begin - 1U) / increment + 1U;
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+        internal_seek_delta(first);
+#endif
+
+        if ((position == first || frames >= cycle) && internal_read_sample(first) == 0) {
+          m_sample = 0;
+          m_active = false;
+          return;
+        }
+
+        phase = loop_begin + frames % cycle * increment;
+      }
+
+      m_end = m_loop_end;
+    }
+
+#if defined(ARDUINO_ARCH_AVR)
+    m_phase.u32 = phase;
+#else   // defined(ARDUINO_ARCH_AVR)
+    m_phase = static_cast<intptr_t>(phase);
+#endif  // defined(ARDUINO_ARCH_AVR)
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    internal_seek_delta(static_cast<uint16_t>(phase >> 16U));
+#endif
+
+    fetch_sample();
   }
 
   //////////////////////////////////////////////////////////////////////////////
@@ -366,6 +845,242 @@ public:
   }
 
 private:
+#if MOD8_OPTION_ASM_MIXER && defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Hand-scheduled version of fetch_sample(), which follows the C++ code step by step.
+  /// Keeps the phase in Z between the sample read and its update, and skips
+  /// the m_sampling handshake: the interrupt can't be preempted by reset().
+  /// The SAME (ASM) tests under simavr compare its output with the C++ code, see test/avr.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void internal_fetch_sample_asm() /* called from interrupt */ {
+    uint16_t position;
+    uint16_t pointer;
+    uint8_t sample;
+    uint8_t volume;
+    uint8_t acc0;
+    uint8_t acc1;
+    uint8_t tmp0;
+    uint8_t tmp1;
+
+    __asm__ __volatile__(
+      // if (!m_active) return;
+      "ldd  %[tmp0], %a[self]+%[o_active]           \n\t"
+      "tst  %[tmp0]                                 \n\t"
+      "breq 3f                                      \n\t"
+      // sample = *position;
+      "ldd  %A[pointer], %a[self]+%[o_phase2]       \n\t"
+      "ldd  %B[pointer], %a[self]+%[o_phase3]       \n\t"
+      "movw %[position], %[pointer]                 \n\t"
+#if MOD8_OPTION_FAR_PROGMEM
+      // Z:RAMPZ = m_sample_base + position; the integer part returns to Z after the read.
+      "ldd  %[tmp0], %a[self]+%[o_base0]            \n\t"
+      "add  %A[pointer], %[tmp0]                    \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_base1]            \n\t"
+      "adc  %B[pointer], %[tmp0]                    \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_base2]            \n\t"
+      "adc  %[tmp0], __zero_reg__                   \n\t"
+      "in   %[tmp1], %[rampz]                       \n\t"
+      "out  %[rampz], %[tmp0]                       \n\t"
+      "elpm %[sample], Z                            \n\t"
+      "out  %[rampz], %[tmp1]                       \n\t"
+      "movw %[pointer], %[position]                 \n\t"
+#else   // MOD8_OPTION_FAR_PROGMEM
+      "lpm  %[sample], Z                            \n\t"
+#endif  // MOD8_OPTION_FAR_PROGMEM
+      // m_sample = sample * m_volume;
+      "ldd  %[volume], %a[self]+%[o_volume]         \n\t"
+      "muls %[sample], %[volume]                    \n\t"
+      "std  %a[self]+%[o_sample0], __tmp_reg__     \n\t"
+      "std  %a[self]+%[o_sample1], __zero_reg__    \n\t"
+      "clr  __zero_reg__                            \n\t"
+      // m_phase += m_phase_increment; integer part stays in Z.
+      "ldd  %[acc0], %a[self]+%[o_phase0]           \n\t"
+      "ldd  %[acc1], %a[self]+%[o_phase1]           \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_inc0]             \n\t"
+      "add  %[acc0], %[tmp0]                        \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_inc1]             \n\t"
+      "adc  %[acc1], %[tmp0]                        \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_inc2]             \n\t"
+      "adc  %A[pointer], %[tmp0]                    \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_inc3]             \n\t"
+      "adc  %B[pointer], %[tmp0]                    \n\t"
+      "std  %a[self]+%[o_phase0], %[acc0]           \n\t"
+      "std  %a[self]+%[o_phase1], %[acc1]           \n\t"
+      // if (phase >= m_end) {
+      "ldd  %[tmp0], %a[self]+%[o_end0]             \n\t"
+      "ldd  %[tmp1], %a[self]+%[o_end1]             \n\t"
+      "cp   %A[pointer], %[tmp0]                    \n\t"
+      "cpc  %B[pointer], %[tmp1]                    \n\t"
+      "brlo 2f                                      \n\t"
+      "ldd  %[acc0], %a[self]+%[o_loopless]         \n\t"
+      "tst  %[acc0]                                 \n\t"
+      "brne 1f                                      \n\t"
+      //   phase -= m_end - m_loop_begin;
+      "sub  %A[pointer], %[tmp0]                    \n\t"
+      "sbc  %B[pointer], %[tmp1]                    \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_loop_begin0]      \n\t"
+      "ldd  %[tmp1], %a[self]+%[o_loop_begin1]      \n\t"
+      "add  %A[pointer], %[tmp0]                    \n\t"
+      "adc  %B[pointer], %[tmp1]                    \n\t"
+      "rjmp 4f                                      \n\t"
+      //   or phase = m_loop_begin and retire the silent one-shot sample;
+      "1:                                           \n\t"
+      "ldd  %A[pointer], %a[self]+%[o_loop_begin0]  \n\t"
+      "ldd  %B[pointer], %a[self]+%[o_loop_begin1]  \n\t"
+      "tst  %[sample]                               \n\t"
+      "brne 4f                                      \n\t"
+      "cp   %A[position], %A[pointer]               \n\t"
+      "cpc  %B[position], %B[pointer]               \n\t"
+      "brne 4f                                      \n\t"
+      "std  %a[self]+%[o_active], __zero_reg__     \n\t"
+      //   m_end = m_loop_end; }
+      "4:                                           \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_loop_end0]        \n\t"
+      "std  %a[self]+%[o_end0], %[tmp0]             \n\t"
+      "ldd  %[tmp0], %a[self]+%[o_loop_end1]        \n\t"
+      "std  %a[self]+%[o_end1], %[tmp0]             \n\t"
+      "2:                                           \n\t"
+      "std  %a[self]+%[o_phase2], %A[pointer]       \n\t"
+      "std  %a[self]+%[o_phase3], %B[pointer]       \n\t"
+      "3:                                           \n\t"
+      : [position] "=&r"(position),
+        [pointer] "=&z"(pointer),
+        [sample] "=&d"(sample),
+        [volume] "=&d"(volume),
+        [acc0] "=&r"(acc0),
+        [acc1] "=&r"(acc1),
+        [tmp0] "=&r"(tmp0),
+        [tmp1] "=&r"(tmp1)
+      : [self] "b"(this),
+        [o_active] "I"(__builtin_offsetof(Sampler, m_active)),
+        [o_volume] "I"(__builtin_offsetof(Sampler, m_volume)),
+        [o_loopless] "I"(__builtin_offsetof(Sampler, m_loopless)),
+        [o_end0] "I"(__builtin_offsetof(Sampler, m_end)),
+        [o_end1] "I"(__builtin_offsetof(Sampler, m_end) + 1),
+        [o_loop_begin0] "I"(__builtin_offsetof(Sampler, m_loop_begin)),
+        [o_loop_begin1] "I"(__builtin_offsetof(Sampler, m_loop_begin) + 1),
+        [o_loop_end0] "I"(__builtin_offsetof(Sampler, m_loop_end)),
+        [o_loop_end1] "I"(__builtin_offsetof(Sampler, m_loop_end) + 1),
+        [o_phase0] "I"(__builtin_offsetof(Sampler, m_phase)),
+        [o_phase1] "I"(__builtin_offsetof(Sampler, m_phase) + 1),
+        [o_phase2] "I"(__builtin_offsetof(Sampler, m_phase) + 2),
+        [o_phase3] "I"(__builtin_offsetof(Sampler, m_phase) + 3),
+        [o_inc0] "I"(__builtin_offsetof(Sampler, m_phase_increment)),
+        [o_inc1] "I"(__builtin_offsetof(Sampler, m_phase_increment) + 1),
+        [o_inc2] "I"(__builtin_offsetof(Sampler, m_phase_increment) + 2),
+        [o_inc3] "I"(__builtin_offsetof(Sampler, m_phase_increment) + 3),
+        [o_sample0] "I"(__builtin_offsetof(Sampler, m_sample)),
+        [o_sample1] "I"(__builtin_offsetof(Sampler, m_sample) + 1)
+#if MOD8_OPTION_FAR_PROGMEM
+        ,
+        [o_base0] "I"(__builtin_offsetof(Sampler, m_sample_base)),
+        [o_base1] "I"(__builtin_offsetof(Sampler, m_sample_base) + 1),
+        [o_base2] "I"(__builtin_offsetof(Sampler, m_sample_base) + 2),
+        [rampz] "I"(_SFR_IO_ADDR(RAMPZ))
+#endif  // MOD8_OPTION_FAR_PROGMEM
+      : "memory");
+  }
+#endif  // MOD8_OPTION_ASM_MIXER && defined(ARDUINO_ARCH_AVR)
+
+#if MOD8_OPTION_INTERPOLATION && !defined(ARDUINO_ARCH_AVR)
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Interpolate linearly between the sample byte at the playback position and the next one to play.
+  /// @param position integer part of m_phase.
+  /// @param sample byte at the position.
+  /// @return ∈ [-128; 127]
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE int8_t internal_interpolate(intptr_t position, int8_t sample) {
+    // Past the end of the section the playback goes on from the loop begin.
+    const intptr_t next = position + 1 < (m_end >> 16) ? position + 1 : (m_loop_begin >> 16);
+    const int32_t delta = internal_read_sample(static_cast<uint16_t>(next)) - sample;
+    const auto fraction = static_cast<uint16_t>(m_phase);
+    return static_cast<int8_t>(sample + ((delta * fraction) >> 16));
+  }
+#endif  // MOD8_OPTION_INTERPOLATION && !defined(ARDUINO_ARCH_AVR)
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Read the sample data byte.
+  /// @param position address on AVR, offset from the sample begin otherwise.
+  //////////////////////////////////////////////////////////////////////////////
+#if MOD8_OPTION_EXTERNAL_STORAGE
+  MOD8_ATTR_INLINE int8_t internal_read_sample(uint16_t position) {
+    using math::u8_to_s8;
+
+    uint16_t offset = position - m_read_ahead_position;
+
+    if (offset >= config::READ_AHEAD_LENGTH) {
+      internal_read_ahead(position);
+      offset = 0;
+    }
+
+    return u8_to_s8(m_read_ahead[offset]);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Fill the read-ahead buffer with the sample data from the position on.
+  /// @param position offset from the sample begin.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_read_ahead(uint16_t position) {
+    m_read_ahead_position = position;
+    storage::read(m_sample_base + position, m_read_ahead, config::READ_AHEAD_LENGTH);
+  }
+#else   // MOD8_OPTION_EXTERNAL_STORAGE
+  MOD8_ATTR_INLINE int8_t internal_read_sample(uint16_t position) {
+    using math::u8_to_s8;
+    using memory::read_sample_byte;
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+    if (m_compressed) {
+      return internal_decode(position);
+    }
+#endif
+
+#if defined(ARDUINO_ARCH_AVR) && !MOD8_INTERNAL_SAMPLE_OFFSETS
+    return u8_to_s8(read_sample_byte(reinterpret_cast<const uint8_t *>(position)));
+#else   // defined(ARDUINO_ARCH_AVR) && !MOD8_INTERNAL_SAMPLE_OFFSETS
+    return u8_to_s8(read_sample_byte(m_sample_base + position));
+#endif  // defined(ARDUINO_ARCH_AVR) && !MOD8_INTERNAL_SAMPLE_OFFSETS
+  }
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Decode the compressed sample at the position.
+  /// Cheap for the positions the sampling moves to: a few samples on, or back into the loop.
+  /// @param position offset from the sample begin.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE int8_t internal_decode(uint16_t position) {
+    using math::u8_to_s8;
+
+    // The phase has wrapped around to the loop.
+    if (static_cast<uint16_t>(position + 1U) < m_next_delta) {
+#if defined(ARDUINO_ARCH_AVR)
+      m_next_delta = m_loop_begin;
+#else   // defined(ARDUINO_ARCH_AVR)
+      m_next_delta = static_cast<uint16_t>(m_loop_begin >> 16);
+#endif  // defined(ARDUINO_ARCH_AVR)
+      m_delta_sum = m_loop_delta_sum;
+    }
+
+    while (m_next_delta <= position) {
+      m_delta_sum += internal::get_delta4(m_sample_base, m_codes, m_next_delta++);
+    }
+
+    return u8_to_s8(m_delta_sum);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Move the decoder of the compressed sample to any position.
+  /// @param position offset from the sample begin.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_seek_delta(uint16_t position) {
+    if (m_compressed) {
+      m_next_delta = position;
+      m_delta_sum = internal::get_delta4_sum(m_sample_base, m_codes, position);
+    }
+  }
+#endif  // MOD8_OPTION_COMPRESSED_SAMPLES
+
   //////////////////////////////////////////////////////////////////////////////
   /// @brief Calc playback speed.
   /// @param period ∈ [MIN_PERIOD; MAX_PERIOD]
@@ -390,11 +1105,31 @@ private:
     m_cached_finetune = m_finetune;
 
     // Fixed-point 18.14
+#if defined(ARDUINO_ARCH_AVR)
     const uint32_t speed_constant = read_table_dword(internal::SPEED_TABLE + m_finetune);
+#else
+    const uint32_t speed_constant = m_rate->speeds[m_finetune];
+#endif
 
     // Fixed-point 18.14 / 16.0 -> 2.14
-    const auto speed = static_cast<uint16_t>(speed_constant / period);
+#if MOD8_OPTION_PERIOD_RECIPROCAL_TABLE && !defined(ARDUINO_ARCH_AVR)
+    const uint16_t speed = internal::calc_period_speed(speed_constant, period, m_rate->reciprocal_min_period);
+#else
+    const uint16_t speed = internal::calc_period_speed(speed_constant, period);
+#endif
+
+#if MOD8_OPTION_COMMAND_QUEUE
+    m_command.speed = speed;
+    m_command.actions |= COMMAND_PERIOD;
+#else   // MOD8_OPTION_COMMAND_QUEUE
+    internal_set_speed(speed);
+#endif  // MOD8_OPTION_COMMAND_QUEUE
+  }
 
+  //////////////////////////////////////////////////////////////////////////////
+  /// @param speed fixed-point 2.14
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE void internal_set_speed(uint16_t speed) {
 #if defined(ARDUINO_ARCH_AVR)
     // Fixed-point 2.14 -> 16.16
     const math::Int32 increment{ (uint32_t)speed << 2U };
@@ -414,7 +1149,7 @@ private:
   // ---------------------------------------------------------------------------
 
   // Sync
-  bool m_active;
+  volatile bool m_active /* cleared from interrupt */;
   volatile bool m_sampling;
 
   // Changeable params
@@ -425,6 +1160,11 @@ private:
   uint16_t m_cached_period;
   uint8_t m_cached_finetune;
 
+#if MOD8_OPTION_COMMAND_QUEUE
+  // Changes not taken yet
+  Command m_command;
+#endif
+
   //
   bool m_loopless;
 
@@ -433,6 +1173,9 @@ private:
   // Optimized for speed.
 
   // Sample data
+#if MOD8_INTERNAL_SAMPLE_OFFSETS
+  memory::SampleAddress m_sample_base;  // The other positions are offsets from it.
+#endif
   uint16_t m_end;
   uint16_t m_loop_begin;
   uint16_t m_loop_end;
@@ -443,8 +1186,11 @@ private:
 
 #else  // defined(ARDUINO_ARCH_AVR)
 
+  // Frequency dependent constants, owned by the player.
+  const internal::Rate *m_rate;
+
   // Sample data
-  const uint8_t *m_sample_base;
+  memory::SampleAddress m_sample_base;
 
   intptr_t m_end;         // fixed-point X.16
   intptr_t m_loop_begin;  // fixed-point X.16
@@ -458,6 +1204,21 @@ private:
 
   // Output
   int16_t m_sample;  // ∈ [-8192; 8128]
+
+#if MOD8_OPTION_EXTERNAL_STORAGE
+  // Sample data from m_read_ahead_position (offset from the sample begin) on.
+  uint16_t m_read_ahead_position;
+  uint8_t m_read_ahead[config::READ_AHEAD_LENGTH];
+#endif
+
+#if MOD8_OPTION_COMPRESSED_SAMPLES
+  // Decoder of the compressed sample.
+  bool m_compressed;
+  uint8_t m_delta_sum;       // sum of the deltas before m_next_delta
+  uint8_t m_loop_delta_sum;  // sum of the deltas before the loop begin
+  uint16_t m_next_delta;     // position of the next delta to add
+  uint16_t m_codes;          // offset of the delta indices from m_sample_base
+#endif
 };
 
 namespace internal {
@@ -470,8 +1231,16 @@ namespace internal {
 constexpr uint16_t SIZE_OF_SAMPLER = sizeof(Sampler);
 constexpr uint16_t SIZE_OF_SAMPLE = sizeof(Sample);
 
-static_assert(SIZE_OF_SAMPLER == 24, "Size of class Sampler was changed!");
-static_assert(SIZE_OF_SAMPLE == 10, "Size of struct Sample was changed!");
+// Sizes with the optional parts.
+constexpr uint16_t EXPECTED_SIZE_OF_SAMPLER =
+  24U + (MOD8_INTERNAL_SAMPLE_OFFSETS ? sizeof(memory::SampleAddress) : 0U)
+  + (MOD8_OPTION_EXTERNAL_STORAGE ? 2U + config::READ_AHEAD_LENGTH : 0U)
+  + (MOD8_OPTION_COMPRESSED_SAMPLES ? 7U : 0U) + (MOD8_OPTION_COMMAND_QUEUE ? 7U : 0U);
+constexpr uint16_t EXPECTED_SIZE_OF_SAMPLE =
+  (MOD8_INTERNAL_FAR_SAMPLES ? 18U : 10U) + (MOD8_OPTION_COMPRESSED_SAMPLES ? 2U : 0U);
+
+static_assert(SIZE_OF_SAMPLER == EXPECTED_SIZE_OF_SAMPLER, "Size of class Sampler was changed!");
+static_assert(SIZE_OF_SAMPLE == EXPECTED_SIZE_OF_SAMPLE, "Size of struct Sample was changed!");
 
 MOD8_INTERNAL_CONSTEXPR_PRINT(SIZE_OF_SAMPLER);
 MOD8_INTERNAL_CONSTEXPR_PRINT(SIZE_OF_SAMPLE);
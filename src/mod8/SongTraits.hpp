@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+#include "Format.hpp"
+#include "Pattern.hpp"
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Song features the player has to support.
+/// A custom traits type describes one song, so the code for unused features compiles away.
+/// See mod-to-inc.py, which generates traits for MOD files. The traits type must have
+/// the same members as this one. Playing a song that doesn't match its traits ignores
+/// the stripped effects and samples.
+////////////////////////////////////////////////////////////////////////////////
+struct DefaultSongTraits {
+  /// @brief Bit N is set if the song uses an effect with Opcode N.
+  static constexpr uint32_t OPCODES = 0xFFFFFFFFUL;
+  /// @brief The highest sample number used in the song.
+  static constexpr uint8_t NUM_SAMPLES = format::NUM_SAMPLES;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Bit of the opcode in SongTraits::OPCODES.
+////////////////////////////////////////////////////////////////////////////////
+constexpr uint32_t opcode_bit(uint8_t opcode) {
+  return 1UL << opcode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Check whether the song uses at least one of the opcodes.
+/// @param opcodes opcode_bit() combination.
+////////////////////////////////////////////////////////////////////////////////
+template <typename Traits>
+constexpr bool song_uses(uint32_t opcodes) {
+  return (Traits::OPCODES & opcodes) != 0;
+}
+
+}  // namespace mod8
@@ -55,9 +55,13 @@ public:
 
   //////////////////////////////////////////////////////////////////////////////
   void set_period(uint16_t new_period) {
-    while (m_load_new_period) {}
-
+    // An unapplied period is overwritten. The interrupt doesn't read the period
+    // while the flag is cleared, so it never sees a half-written value.
+    // Don't wait for the interrupt: there is none when the player fast-forwards.
+    m_load_new_period = false;
+    memory::barrier();
     m_new_period = new_period;
+    memory::barrier();
     m_load_new_period = true;
   }
 
@@ -85,6 +89,38 @@ public:
     }
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief How many clock() calls are left until the timer fires, inclusive.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint16_t get_clocks_to_fire() const {
+    return m_load_new_period ? m_new_period : m_counter;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Same as `count` calls of clock() in a row.
+  /// @param count ∈ [1; get_clocks_to_fire()]
+  //////////////////////////////////////////////////////////////////////////////
+  void advance(uint16_t count) {
+    if (m_load_new_period) {
+      m_period = m_counter = m_new_period;
+      m_load_new_period = false;
+    }
+
+    m_counter -= count;
+
+    if (m_counter == 0) {
+      m_counter = m_period;
+      m_fire_counter++;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief How many times the timer has fired since the last is_fired() call.
+  //////////////////////////////////////////////////////////////////////////////
+  MOD8_ATTR_INLINE uint8_t get_pending_count() const {
+    return static_cast<uint8_t>(m_fire_counter - m_fire_counter_last);
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   bool is_fired() {
     const uint8_t counter = m_fire_counter;
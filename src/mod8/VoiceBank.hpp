@@ -0,0 +1,219 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Config.hpp"
+#include "Format.hpp"
+#include "Math.hpp"
+#include "Sampler.hpp"
+
+#if !defined(ARDUINO_ARCH_AVR) && MOD8_INTERNAL_SIMD_MIXER
+
+namespace mod8 {
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Structure-of-arrays copy of the channel samplers for block mixing.
+/// Each lane is mixed into a chunk of frames between its wraparound points,
+/// then the chunks are scaled in one pass, so the compiler vectorizes the loops.
+/// Bit-exact with sequential Sampler::fetch_sample() calls.
+/// @tparam NUM_LANES number of the song channels: 4, 6 or 8.
+////////////////////////////////////////////////////////////////////////////////
+template <uint8_t NUM_LANES>
+class VoiceBank {
+public:
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Copy the sampler state to the lane.
+  //////////////////////////////////////////////////////////////////////////////
+  void load(uint8_t lane, const Sampler &sampler) {
+    // Player::load() rejects songs larger than 64 KiB, so X.16 offsets fit into 32 bits.
+    if (sampler.m_active) {
+      m_base[lane] = sampler.m_sample_base;
+      m_phase[lane] = static_cast<uint32_t>(sampler.m_phase);
+      m_increment[lane] = static_cast<uint32_t>(sampler.m_phase_increment);
+      m_end[lane] = static_cast<uint32_t>(sampler.m_end);
+      m_loop_begin[lane] = static_cast<uint32_t>(sampler.m_loop_begin);
+      m_loop_end[lane] = static_cast<uint32_t>(sampler.m_loop_end);
+      m_loopless[lane] = sampler.m_loopless;
+      m_volume[lane] = sampler.m_volume;
+      m_retired[lane] = false;
+      m_sample[lane] = sampler.m_sample;
+    } else {
+      load_silence(lane);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Make the lane output zeros.
+  //////////////////////////////////////////////////////////////////////////////
+  void load_silence(uint8_t lane) {
+    m_retired[lane] = true;
+    m_sample[lane] = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Copy the lane state back to the active sampler.
+  //////////////////////////////////////////////////////////////////////////////
+  void store(uint8_t lane, Sampler &sampler) const {
+    if (!sampler.m_active) {
+      return;
+    }
+
+    sampler.m_phase = m_phase[lane];
+    sampler.m_end = m_end[lane];
+    sampler.m_sample = m_sample[lane];
+
+    if (m_retired[lane]) {
+      sampler.m_active = false;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Mix a block of frames.
+  /// Left output is the sum of lanes 0, 3, 4 and 7, right output is the sum of lanes 1, 2, 5 and 6.
+  /// @param left buffer for left channel samples.
+  /// @param right buffer for right channel samples.
+  /// @param stride distance between consecutive samples of the same channel.
+  /// @param frames number of frames to mix.
+  //////////////////////////////////////////////////////////////////////////////
+  void mix(int16_t *left, int16_t *right, size_t stride, size_t frames) {
+    static_assert(NUM_LANES == 4 || NUM_LANES == 6 || NUM_LANES == 8, "Unsupported number of lanes");
+
+    // Two lanes per side use the full output range, more lanes share it.
+    constexpr int16_t GAIN = NUM_LANES == 4 ? 2 : 1;
+
+    while (frames != 0) {
+      const size_t count = frames < CHUNK_LENGTH ? frames : CHUNK_LENGTH;
+
+      // Range [-16384; 16256]
+      int16_t chunk_left[CHUNK_LENGTH];
+      int16_t chunk_right[CHUNK_LENGTH];
+
+      for (size_t frame = 0; frame != count; ++frame) {
+        chunk_left[frame] = 0;
+        chunk_right[frame] = 0;
+      }
+
+      for (uint8_t lane = 0; lane != NUM_LANES; ++lane) {
+        // Amiga panning L R R L, repeated for the lanes 4-7.
+        internal_mix_lane(lane, ((lane + 1U) & 2U) ? chunk_right : chunk_left, count);
+      }
+
+      // Range : [-32768; 32512]
+      for (size_t frame = 0; frame != count; ++frame) {
+        left[frame * stride] = static_cast<int16_t>(chunk_left[frame] * GAIN);
+        right[frame * stride] = static_cast<int16_t>(chunk_right[frame] * GAIN);
+      }
+
+      left += count * stride;
+      right += count * stride;
+      frames -= count;
+    }
+  }
+
+private:
+  //////////////////////////////////////////////////////////////////////////////
+  static constexpr size_t CHUNK_LENGTH = 256;
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @brief Add `count` samples of the lane to the chunk.
+  /// The wraparound points are found in advance, so the loop between them is branchless.
+  //////////////////////////////////////////////////////////////////////////////
+  void internal_mix_lane(uint8_t lane, int16_t *chunk, size_t count) {
+    using math::u8_to_s8;
+    using memory::read_song_byte;
+
+    if (m_retired[lane]) {
+      return;
+    }
+
+    const uint8_t *const base = m_base[lane];
+    const uint32_t increment = m_increment[lane];
+    const int16_t volume = m_volume[lane];
+
+    uint32_t phase = m_phase[lane];
+    uint32_t end = m_end[lane];
+    uint32_t frame = 0;
+
+    while (frame != count) {
+      const uint32_t remaining = static_cast<uint32_t>(count) - frame;
+
+      // Frames up to the wraparound, inclusive.
+      uint32_t run = phase < end ? (end - phase - 1U) / increment + 1U : 1U;
+      const bool wrap = run <= remaining;
+
+      if (!wrap) {
+        run = remaining;
+      }
+
+      // The last sample of the run sets the state.
+      const uint32_t position = (phase + (run - 1U) * increment) >> 16U;
+      const int8_t sample = u8_to_s8(read_song_byte(base + position));
+
+      for (int16_t *output = chunk + frame, *const output_end = output + run; output != output_end; ++output) {
+        *output = static_cast<int16_t>(*output + volume * u8_to_s8(read_song_byte(base + (phase >> 16U))));
+        phase += increment;
+      }
+
+      frame += run;
+
+      // m_sample ∈ [-8192; 8128]
+      m_sample[lane] = static_cast<int16_t>(volume * sample);
+
+      if (wrap) {
+        if (!m_loopless[lane]) {
+          phase -= (end - m_loop_begin[lane]);
+        } else {
+          // A one-shot sample stuck on silence will never sound again.
+          if (sample == 0 && position == (m_loop_begin[lane] >> 16U)) {
+            m_retired[lane] = true;
+            break;
+          }
+
+          phase = m_loop_begin[lane];
+        }
+
+        end = m_loop_end[lane];
+      }
+    }
+
+    m_phase[lane] = phase;
+    m_end[lane] = end;
+  }
+
+  const uint8_t *m_base[NUM_LANES];
+  uint32_t m_phase[NUM_LANES];       // fixed-point 16.16
+  uint32_t m_increment[NUM_LANES];   // fixed-point 16.16
+  uint32_t m_end[NUM_LANES];         // fixed-point 16.16
+  uint32_t m_loop_begin[NUM_LANES];  // fixed-point 16.16
+  uint32_t m_loop_end[NUM_LANES];    // fixed-point 16.16
+  bool m_loopless[NUM_LANES];
+  bool m_retired[NUM_LANES];
+  int16_t m_volume[NUM_LANES];  // ∈ [0; MAX_VOLUME]
+  int16_t m_sample[NUM_LANES];  // ∈ [-8192; 8128]
+};
+
+}  // namespace mod8
+
+#endif  // !defined(ARDUINO_ARCH_AVR) && MOD8_INTERNAL_SIMD_MIXER
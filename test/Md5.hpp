@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Incremental MD5 digest (RFC 1321).
+////////////////////////////////////////////////////////////////////////////////
+class Md5 {
+public:
+  //////////////////////////////////////////////////////////////////////////////
+  void update(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+
+    while (size != 0) {
+      const size_t offset = static_cast<size_t>(m_length % BLOCK_SIZE);
+      size_t chunk = BLOCK_SIZE - offset;
+      if (chunk > size) {
+        chunk = size;
+      }
+
+      if (offset == 0 && chunk == BLOCK_SIZE) {
+        transform(bytes);
+      } else {
+        for (size_t i = 0; i != chunk; ++i) {
+          m_block[offset + i] = bytes[i];
+        }
+
+        if (offset + chunk == BLOCK_SIZE) {
+          transform(m_block);
+        }
+      }
+
+      m_length += chunk;
+      bytes += chunk;
+      size -= chunk;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  /// @return Lowercase hex digest. Resets nothing, so call it once.
+  //////////////////////////////////////////////////////////////////////////////
+  std::string hex_digest() {
+    const uint64_t bit_length = m_length * 8U;
+
+    static const uint8_t PADDING[BLOCK_SIZE] = { 0x80 };
+    const size_t offset = static_cast<size_t>(m_length % BLOCK_SIZE);
+    update(PADDING, offset < 56U ? 56U - offset : 120U - offset);
+
+    uint8_t length[8];
+    for (unsigned i = 0; i != 8; ++i) {
+      length[i] = static_cast<uint8_t>(bit_length >> (8U * i));
+    }
+    update(length, sizeof(length));
+
+    std::string digest;
+    for (const uint32_t word : m_state) {
+      for (unsigned i = 0; i != 4; ++i) {
+        char hex[3];
+        snprintf(hex, sizeof(hex), "%02x", static_cast<unsigned>((word >> (8U * i)) & 0xffU));
+        digest += hex;
+      }
+    }
+
+    return digest;
+  }
+
+private:
+  static constexpr size_t BLOCK_SIZE = 64;
+
+  //////////////////////////////////////////////////////////////////////////////
+  static uint32_t rotate_left(uint32_t value, unsigned shift) {
+    return (value << shift) | (value >> (32U - shift));
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  void transform(const uint8_t *block) {
+    static const uint32_t K[64] = {
+      0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+      0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+      0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+      0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+      0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+      0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+      0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+      0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    static const unsigned SHIFTS[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+
+    uint32_t words[16];
+    for (unsigned i = 0; i != 16; ++i) {
+      words[i] = static_cast<uint32_t>(block[i * 4 + 0])
+               | static_cast<uint32_t>(block[i * 4 + 1]) << 8U
+               | static_cast<uint32_t>(block[i * 4 + 2]) << 16U
+               | static_cast<uint32_t>(block[i * 4 + 3]) << 24U;
+    }
+
+    uint32_t a = m_state[0];
+    uint32_t b = m_state[1];
+    uint32_t c = m_state[2];
+    uint32_t d = m_state[3];
+
+    for (unsigned i = 0; i != 64; ++i) {
+      uint32_t f;
+      unsigned g;
+
+      switch (i / 16U) {
+        case 0:
+          f = (b & c) | (~b & d);
+          g = i;
+          break;
+        case 1:
+          f = (d & b) | (~d & c);
+          g = (5U * i + 1U) % 16U;
+          break;
+        case 2:
+          f = b ^ c ^ d;
+          g = (3U * i + 5U) % 16U;
+          break;
+        default:
+          f = c ^ (b | ~d);
+          g = (7U * i) % 16U;
+          break;
+      }
+
+      const uint32_t rotated = rotate_left(a + f + K[i] + words[g], SHIFTS[(i / 16U) * 4U + i % 4U]);
+      a = d;
+      d = c;
+      c = b;
+      b += rotated;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  uint32_t m_state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+  uint8_t m_block[BLOCK_SIZE] = {};
+  uint64_t m_length = 0;
+};
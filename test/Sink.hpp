@@ -0,0 +1,252 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "Md5.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace sink {
+
+// clang-format off
+
+//------------------------------------------------------------------------------
+struct WavHeader {
+  uint8_t riff_chunk_id[4];
+  uint8_t riff_chunk_size[4];
+  uint8_t riff_format[4];
+  uint8_t fmt_chunk_id[4];
+  uint8_t fmt_chunk_size[4];
+  uint8_t fmt_codec[2];
+  uint8_t fmt_num_channels[2];
+  uint8_t fmt_sample_rate[4];
+  uint8_t fmt_byte_rate[4];
+  uint8_t fmt_block_align[2];
+  uint8_t fmt_bits_per_sample[2];
+  uint8_t data_chunk_id[4];
+  uint8_t data_chunk_size[4];
+};
+
+//------------------------------------------------------------------------------
+const WavHeader WAV_HEADER = {
+  'R', 'I', 'F', 'F',                     // $00: riff_chunk_id
+  0x00, 0x00, 0x00, 0x00,                 // $04: riff_chunk_size
+  'W', 'A', 'V', 'E',                     // $08: riff_format
+  
+  // format subchunk
+  'f', 'm', 't', ' ',                     // $0C: fmt_chunk_id
+  0x10, 0x00, 0x00, 0x00,                 // $10: fmt_chunk_size (16 for PCM)
+  0x01, 0x00,                             // $14: fmt_codec (1 for PCM)
+  0x02, 0x00,                             // $16: fmt_num_channels (2 for stereo)
+  0x00, 0x00, 0x00, 0x00,                 // $18: fmt_sample_rate
+  0x00, 0x00, 0x01, 0x00,                 // $1C: fmt_byte_rate
+  0x04, 0x00,                             // $20: fmt_block_align (4 for 16-bit stereo)
+  0x10, 0x00,                             // $22: fmt_bits_per_sample (16)
+  
+  // data subchunk
+  'd', 'a', 't', 'a',                     // $24: data_chunk_id
+  0x00, 0x00, 0x00, 0x00                  // $28: data_chunk_size
+};
+
+// clang-format on
+
+static_assert(sizeof(WavHeader) == 44);
+
+//------------------------------------------------------------------------------
+constexpr void u32_to_le(uint32_t value, uint8_t (&output)[4]) {
+  output[0] = (value >> 0x00U) & 0xFFU;
+  output[1] = (value >> 0x08U) & 0xFFU;
+  output[2] = (value >> 0x10U) & 0xFFU;
+  output[3] = (value >> 0x18U) & 0xFFU;
+}
+
+//------------------------------------------------------------------------------
+constexpr void u16_to_le(uint16_t value, uint8_t (&output)[2]) {
+  output[0] = (value >> 0x00U) & 0xFFU;
+  output[1] = (value >> 0x08U) & 0xFFU;
+}
+
+//------------------------------------------------------------------------------
+/// Header for `data_size` bytes of 16-bit stereo PCM.
+WavHeader make_wav_header(size_t data_size, uint32_t sample_rate) {
+  constexpr size_t BLOCK_SIZE = 2 * sizeof(int16_t);
+  constexpr size_t RIFF_HEADER_SIZE = sizeof(WavHeader::riff_chunk_id)
+                                    + sizeof(WavHeader::riff_chunk_size);
+
+  WavHeader header = WAV_HEADER;
+  u32_to_le(sample_rate, header.fmt_sample_rate);
+  u32_to_le(static_cast<uint32_t>(sample_rate * BLOCK_SIZE), header.fmt_byte_rate);
+  u32_to_le(static_cast<uint32_t>(data_size + sizeof(WavHeader) - RIFF_HEADER_SIZE),
+            header.data_chunk_size);
+  u32_to_le(static_cast<uint32_t>(data_size), header.data_chunk_size);
+  return header;
+}
+
+//------------------------------------------------------------------------------
+/// Destination of rendered audio.
+class Sink {
+public:
+  virtual ~Sink() = default;
+
+  /// Accepts a block of interleaved 16-bit stereo frames.
+  virtual bool write(const int16_t *interleaved, size_t frames) = 0;
+
+  /// Called once after the last block.
+  virtual bool finish() = 0;
+
+protected:
+  /// Appends the frames to the buffer as 16-bit little-endian PCM.
+  static void encode(const int16_t *interleaved, size_t frames, std::vector<uint8_t> &buffer) {
+    const size_t offset = buffer.size();
+    buffer.resize(offset + frames * 2 * sizeof(int16_t));
+
+    uint8_t *out = buffer.data() + offset;
+    for (size_t i = 0; i != frames * 2; ++i) {
+      uint8_t sample[2];
+      u16_to_le(static_cast<uint16_t>(interleaved[i]), sample);
+      *out++ = sample[0];
+      *out++ = sample[1];
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+/// Writes raw PCM into an open file in large chunks, e.g. to stdout for piping into an encoder.
+class RawFileSink : public Sink {
+public:
+  static constexpr size_t BUFFER_SIZE = 1U << 20U;
+
+  explicit RawFileSink(FILE *file)
+    : m_file(file) {
+    m_buffer.reserve(BUFFER_SIZE + 4096U * 2U * sizeof(int16_t));
+  }
+
+  bool write(const int16_t *interleaved, size_t frames) override {
+    encode(interleaved, frames, m_buffer);
+    return m_buffer.size() < BUFFER_SIZE || flush();
+  }
+
+  bool finish() override {
+    return flush() && fflush(m_file) == 0;
+  }
+
+  /// Number of PCM bytes written so far.
+  size_t data_size() const {
+    return m_data_size;
+  }
+
+protected:
+  bool flush() {
+    if (m_buffer.empty()) {
+      return true;
+    }
+
+    if (fwrite(m_buffer.data(), m_buffer.size(), 1, m_file) != 1) {
+      return false;
+    }
+
+    m_data_size += m_buffer.size();
+    m_buffer.clear();
+    return true;
+  }
+
+  FILE *m_file;
+  std::vector<uint8_t> m_buffer;
+  size_t m_data_size = 0;
+};
+
+//------------------------------------------------------------------------------
+/// Writes a WAV file. The header is updated with the data size in finish().
+class WavFileSink : public RawFileSink {
+public:
+  WavFileSink(FILE *file, uint32_t sample_rate)
+    : RawFileSink(file)
+    , m_sample_rate(sample_rate) {
+  }
+
+  /// Writes a placeholder header.
+  bool start() {
+    return fwrite(&WAV_HEADER, sizeof(WAV_HEADER), 1, m_file) == 1;
+  }
+
+  bool finish() override {
+    if (!flush()) {
+      return false;
+    }
+
+    const WavHeader header = make_wav_header(m_data_size, m_sample_rate);
+
+    rewind(m_file);
+    return fwrite(&header, sizeof(header), 1, m_file) == 1 && fflush(m_file) == 0;
+  }
+
+private:
+  uint32_t m_sample_rate;
+};
+
+//------------------------------------------------------------------------------
+/// Writes nothing, only calculates MD5 of the WAV file image.
+/// The header goes first, so the data size is given in advance and checked in finish().
+class WavHashSink : public Sink {
+public:
+  WavHashSink(uint32_t sample_rate, size_t data_size)
+    : m_data_size(data_size) {
+    const WavHeader header = make_wav_header(data_size, sample_rate);
+    m_md5.update(&header, sizeof(header));
+  }
+
+  bool write(const int16_t *interleaved, size_t frames) override {
+    m_buffer.clear();
+    encode(interleaved, frames, m_buffer);
+    m_md5.update(m_buffer.data(), m_buffer.size());
+    m_written += m_buffer.size();
+    return m_written <= m_data_size;
+  }
+
+  bool finish() override {
+    if (m_written != m_data_size) {
+      return false;
+    }
+
+    m_digest = m_md5.hex_digest();
+    return true;
+  }
+
+  /// Lowercase hex MD5, valid after finish().
+  const std::string &hex_digest() const {
+    return m_digest;
+  }
+
+private:
+  Md5 m_md5;
+  size_t m_data_size;
+  size_t m_written = 0;
+  std::vector<uint8_t> m_buffer;
+  std::string m_digest;
+};
+
+}  // namespace sink
@@ -0,0 +1,185 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2025 Konstantin Polevik
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+// Firmware for run-cycles.py: plays the song on a simulated ATmega328P and prints
+// the clock costs of tick() and update() and the hash of the output to the simavr console.
+
+#include <AVRModPlay.h>
+
+#include <avr/sleep.h>
+
+#include "avr_mcu_section.h"
+
+#if !defined(MOD8_TEST_SECONDS)
+/// Maximum duration of the playback (in seconds).
+#define MOD8_TEST_SECONDS 30
+#endif
+
+AVR_MCU(F_CPU, "atmega328p");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+namespace {
+
+//------------------------------------------------------------------------------
+const uint8_t PROGMEM g_song[] = {
+#include "song.inc"
+};
+
+mod8::Player g_player;
+
+//------------------------------------------------------------------------------
+/// Worst-case and average cost (in CPU clocks).
+struct Cost {
+  uint16_t max;
+  uint32_t sum;
+  uint32_t count;
+
+  void add(uint16_t cost) {
+    if (cost > max) {
+      max = cost;
+    }
+
+    sum += cost;
+    ++count;
+  }
+};
+
+Cost g_tick_cost;
+Cost g_update_cost;
+Cost g_idle_cost;
+
+/// FNV-1a hash of the output frames, the same for the C++ and the assembly mixers.
+uint32_t g_output_hash = 2166136261UL;
+
+//------------------------------------------------------------------------------
+void hash_output(uint16_t value) {
+  g_output_hash = (g_output_hash ^ (value & 0xFFU)) * 16777619UL;
+  g_output_hash = (g_output_hash ^ (value >> 8)) * 16777619UL;
+}
+
+//------------------------------------------------------------------------------
+void print(const char *text) {
+  while (*text != '\0') {
+    GPIOR0 = *text++;
+  }
+}
+
+//------------------------------------------------------------------------------
+void print(uint32_t n) {
+  char digits[11];
+  char *p = digits + sizeof(digits) - 1;
+
+  *p = '\0';
+  do {
+    *--p = static_cast<char>('0' + n % 10U);
+    n /= 10U;
+  } while (n != 0);
+
+  print(p);
+}
+
+//------------------------------------------------------------------------------
+void print(const char *name, const Cost &cost) {
+  print("CYCLES ");
+  print(name);
+  print(" max=");
+  print(cost.max);
+  print(" avg=");
+  print(cost.count != 0 ? cost.sum / cost.count : 0);
+  print(" count=");
+  print(cost.count);
+  print("\n");
+}
+
+//------------------------------------------------------------------------------
+/// Called like the interrupt routine would call it, so the call overhead is counted.
+/// The prologue and epilogue of the interrupt routine itself are not: they push and pop
+/// the call-clobbered registers and SREG, which a plain call doesn't need.
+__attribute__((noinline)) void call_tick() {
+  g_player.tick();
+}
+
+//------------------------------------------------------------------------------
+__attribute__((noinline)) mod8::Player::UpdateResult call_update() {
+  return g_player.update();
+}
+
+}
+
+//------------------------------------------------------------------------------
+int main() {
+  using mod8::Player;
+
+  // Timer 1 counts CPU clocks, the costs are below 2^16 clocks.
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  // Cost of reading the counter, subtracted from the measurements.
+  const uint16_t t0 = TCNT1;
+  const uint16_t overhead = TCNT1 - t0;
+
+  g_player.init();
+  if (!g_player.load(g_song, sizeof(g_song))) {
+    print("ERROR load\n");
+  } else {
+    constexpr uint32_t MAX_FRAMES = static_cast<uint32_t>(mod8::config::MIXING_FREQ) * MOD8_TEST_SECONDS;
+
+    for (uint32_t frame = 0; frame != MAX_FRAMES; ++frame) {
+      uint16_t begin = TCNT1;
+      const Player::UpdateResult result = call_update();
+      uint16_t cost = TCNT1 - begin - overhead;
+
+      if (result == Player::UpdateResult::INACTIVE) {
+        break;
+      }
+
+      if (result == Player::UpdateResult::IDLE) {
+        g_idle_cost.add(cost);
+      } else {
+        g_update_cost.add(cost);
+      }
+
+      begin = TCNT1;
+      call_tick();
+      cost = TCNT1 - begin - overhead;
+
+      g_tick_cost.add(cost);
+
+      hash_output(g_player.output().left.u16);
+      hash_output(g_player.output().right.u16);
+    }
+
+    print("tick", g_tick_cost);
+    print("update", g_update_cost);
+    print("idle", g_idle_cost);
+    print("HASH ");
+    print(g_output_hash);
+    print("\n");
+    print("DONE\n");
+  }
+
+  // simavr quits when the CPU sleeps with interrupts disabled.
+  cli();
+  sleep_cpu();
+  return 0;
+}
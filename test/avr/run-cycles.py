@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2025 Konstantin Polevik
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# CTest treats the exit code as a skipped test, see SKIP_RETURN_CODE.
+SKIP = 77
+
+CYCLES_PATTERN = re.compile(r"CYCLES (\w+) max=(\d+) avg=(\d+) count=(\d+)")
+HASH_PATTERN = re.compile(r"HASH (\d+)")
+HASH_FILE = "hash.txt"
+
+
+def write_song_include(data, file_name):
+    with open(file_name, "w") as f:
+        for i in range(0, len(data), 16):
+            f.write("  " + ", ".join(f"0x{b:02x}" for b in data[i : i + 16]) + ",\n")
+
+
+def build_firmware(args, work_dir):
+    elf_file = os.path.join(work_dir, "cycles.elf")
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+
+    command = [
+        args.cxx,
+        "-mmcu=atmega328p",
+        f"-DF_CPU={args.f_cpu}UL",
+        "-DARDUINO=10800",
+        "-DARDUINO_ARCH_AVR",
+        f"-DMOD8_TEST_SECONDS={args.seconds}",
+        "-std=gnu++11",
+        "-Os",
+        "-fno-exceptions",
+        "-fno-threadsafe-statics",
+        "-ffunction-sections",
+        "-fdata-sections",
+        "-Wl,--gc-sections",
+        "-I" + script_dir,
+        "-I" + args.source_dir,
+        "-I" + args.simavr_include,
+        "-I" + work_dir,
+    ]
+    command += ["-D" + define for define in args.define]
+    command += [os.path.join(script_dir, "cycles.cpp"), "-o", elf_file]
+
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        if "overflowed" in result.stderr:
+            return None
+        raise Exception("Unable to build the firmware:\n" + result.stderr)
+
+    return elf_file
+
+
+def compare_hashes(reference_dir, actual_dir):
+    hashes = []
+    for work_dir in (reference_dir, actual_dir):
+        file_name = os.path.join(work_dir, HASH_FILE)
+        if not os.path.exists(file_name):
+            print(f"No output hash in {work_dir}, its run was skipped or failed")
+            return SKIP
+
+        with open(file_name) as f:
+            hashes.append(f.read().strip())
+
+    if hashes[0] != hashes[1]:
+        print(f"The output hash {hashes[1]} differs from the reference hash {hashes[0]}")
+        return 1
+
+    print(f"The output hash {hashes[1]} is the same as the reference one")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycle budget test runner")
+    parser.add_argument(
+        "--compare",
+        nargs=2,
+        metavar=("REFERENCE_DIR", "WORK_DIR"),
+        help="only compare the output hashes of two runs",
+    )
+    parser.add_argument("-i", "--input", help="MOD file")
+    parser.add_argument("--cxx", help="avr-g++ executable")
+    parser.add_argument("--simavr", help="simavr executable")
+    parser.add_argument("--simavr-include", help="folder of avr_mcu_section.h")
+    parser.add_argument("--source-dir", help="folder of AVRModPlay.h")
+    parser.add_argument("--work-dir", help="folder for the firmware")
+    parser.add_argument("--f-cpu", type=int, default=16000000, help="CPU clock frequency (in Hertz)")
+    parser.add_argument("--seconds", type=int, default=30, help="maximum duration of the playback")
+    parser.add_argument("--config", default="CPP", help="name of the configuration in the budget options")
+    parser.add_argument("--margin", type=int, default=10, help="margin of the suggested budgets (in percent)")
+    parser.add_argument("--tick-max", type=int, default=0, help="budget for the worst-case tick() cost")
+    parser.add_argument("--tick-avg", type=int, default=0, help="budget for the average tick() cost")
+    parser.add_argument("--update-max", type=int, default=0, help="budget for the worst-case update() cost")
+    parser.add_argument(
+        "-D",
+        "--define",
+        action="append",
+        default=[],
+        help="library option, e.g. MOD8_OPTION_ASM_MIXER=true",
+    )
+
+    args = parser.parse_args()
+
+    if args.compare:
+        return compare_hashes(*args.compare)
+
+    for name in ("input", "cxx", "simavr", "simavr_include", "source_dir", "work_dir"):
+        if getattr(args, name) is None:
+            parser.error(f"--{name.replace('_', '-')} is required")
+
+    os.makedirs(args.work_dir, exist_ok=True)
+
+    hash_file = os.path.join(args.work_dir, HASH_FILE)
+    if os.path.exists(hash_file):
+        os.remove(hash_file)
+
+    with open(args.input, "rb") as f:
+        write_song_include(f.read(), os.path.join(args.work_dir, "song.inc"))
+
+    elf_file = build_firmware(args, args.work_dir)
+    if elf_file is None:
+        print("The song doesn't fit into the flash memory of ATmega328P")
+        return SKIP
+
+    result = subprocess.run(
+        [args.simavr, "-m", "atmega328p", "-f", str(args.f_cpu), elf_file],
+        capture_output=True,
+        text=True,
+    )
+
+    # simavr prints the console output to stderr.
+    output = result.stdout + result.stderr
+    costs = {}
+    for match in CYCLES_PATTERN.finditer(output):
+        costs[match.group(1)] = tuple(int(value) for value in match.group(2, 3, 4))
+
+    hash_match = HASH_PATTERN.search(output)
+    if "DONE" not in output or "tick" not in costs or "update" not in costs or hash_match is None:
+        raise Exception("No results from the firmware:\n" + output)
+
+    with open(hash_file, "w") as f:
+        f.write(hash_match.group(1) + "\n")
+
+    for name, (max_cost, avg_cost, count) in costs.items():
+        print(f"{name:>6}: max {max_cost:5d}, avg {avg_cost:5d} clocks, {count} calls")
+
+    budgets = [
+        ("tick", 0, args.tick_max, "worst-case tick()", "TICK_MAX"),
+        ("tick", 1, args.tick_avg, "average tick()", "TICK_AVG"),
+        ("update", 0, args.update_max, "worst-case update()", "UPDATE_MAX"),
+    ]
+
+    if all(budget == 0 for _, _, budget, _, _ in budgets):
+        # A test that can't fail must not pass: report it as skipped until the budgets are set.
+        print(f"No budgets set, with a margin of {args.margin}% they would be:")
+        for name, index, _, _, option in budgets:
+            suggested = costs[name][index] * (100 + args.margin) // 100
+            print(f"  -DAVRMODPLAY_{args.config}_{option}_CLOCKS={suggested}")
+        return SKIP
+
+    failed = False
+    for name, index, budget, title, _ in budgets:
+        cost = costs[name][index]
+        if budget == 0:
+            print(f"No budget set for the {title} cost")
+        elif cost > budget:
+            print(f"The {title} cost of {cost} clocks exceeds the budget of {budget} clocks")
+            failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2025 Konstantin Polevik
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Checks that the songs optimized by extras/songs/mod-to-inc.py --optimize
+# render the same as the original ones.
+#
+import argparse
+import importlib.util
+import os
+import subprocess
+import sys
+
+
+def load_converter(path):
+    spec = importlib.util.spec_from_file_location("mod_to_inc", path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def render_md5(app, file_name):
+    result = subprocess.run([app, "--md5", file_name], capture_output=True, text=True)
+    return result.returncode, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Checks the rendering of the optimized songs")
+    parser.add_argument("-a", "--app", required=True, help="AvrModPlayTest")
+    parser.add_argument("-t", "--tool", required=True, help="mod-to-inc.py")
+    parser.add_argument("-o", "--output", required=True, help="folder for the optimized songs")
+    parser.add_argument("files", nargs="+", help="MOD files")
+
+    args = parser.parse_args()
+    converter = load_converter(args.tool)
+    os.makedirs(args.output, exist_ok=True)
+
+    failed = 0
+    for file_name in args.files:
+        with open(file_name, "rb") as f:
+            data = f.read()
+
+        optimized_name = os.path.join(args.output, os.path.basename(file_name))
+        with open(optimized_name, "wb") as f:
+            f.write(converter.optimize_song(data))
+
+        expected = render_md5(args.app, file_name)
+        actual = render_md5(args.app, optimized_name)
+        if expected[0] != 0:
+            print(f"{file_name}: unable to render")
+            failed += 1
+        elif expected != actual:
+            print(f"{file_name}: the optimized song renders differently")
+            failed += 1
+
+    print(f"{len(args.files) - failed}/{len(args.files)} songs passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
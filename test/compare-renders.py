@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2025 Konstantin Polevik
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Checks that a variant of the test application, built with other library options,
+# renders the songs the same as the reference build.
+#
+import argparse
+import subprocess
+import sys
+
+
+def render_md5(app, file_name, rate=None):
+    rate_args = ["--rate", str(rate)] if rate else []
+    result = subprocess.run([app] + rate_args + ["--md5", file_name], capture_output=True, text=True)
+    return result.returncode, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares the rendering of two builds")
+    parser.add_argument("-r", "--reference", required=True, help="reference build of AvrModPlayTest")
+    parser.add_argument("-a", "--app", required=True, help="variant of AvrModPlayTest")
+    parser.add_argument("--rate", type=int, help="mixing frequency the variant selects at run time (in Hertz)")
+    parser.add_argument("files", nargs="+", help="MOD files")
+
+    args = parser.parse_args()
+
+    failed = 0
+    for file_name in args.files:
+        expected = render_md5(args.reference, file_name)
+        actual = render_md5(args.app, file_name, args.rate)
+        if expected[0] != 0:
+            print(f"{file_name}: unable to render")
+            failed += 1
+        elif expected != actual:
+            print(f"{file_name}: the variant renders differently")
+            failed += 1
+
+    print(f"{len(args.files) - failed}/{len(args.files)} songs passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
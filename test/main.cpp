@@ -22,21 +22,88 @@
  * SOFTWARE.
  */
 #define MOD8_OPTION_PLAYER_EVENTS true
+#define MOD8_OPTION_CHECKPOINTS true
+#define MOD8_OPTION_EVENT_QUEUE true
+#if !defined(MOD8_PARAM_MIXING_FREQ)
 #define MOD8_PARAM_MIXING_FREQ 48000
+#endif
 #include <AVRModPlay.h>
 
+#include "Sink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
 
+#if !defined(TEST_NUM_CHANNELS)
+#define TEST_NUM_CHANNELS 4
+#endif
+
+//------------------------------------------------------------------------------
+/// Player of the songs with TEST_NUM_CHANNELS channels, set by the build of the variant.
+using Player = mod8::BasicPlayer<mod8::DefaultSongTraits, TEST_NUM_CHANNELS>;
+
+//------------------------------------------------------------------------------
+/// Player of the same songs in another output format, see check_formats().
+template <typename Output>
+using FormatPlayer = mod8::BasicPlayer<mod8::DefaultSongTraits, TEST_NUM_CHANNELS, Output>;
+
+//------------------------------------------------------------------------------
+/// Song position where a pattern starts playing.
+struct Position {
+  uint8_t order;
+  uint8_t row;
+  size_t frame;
+};
+
+//------------------------------------------------------------------------------
+/// Everything needed to play one song. Each thread works with its own session.
+struct Session {
+  std::vector<uint8_t> song;  // Song data followed by SONG_GUARD_SIZE zero bytes.
+  size_t song_size = 0;
+  Player player;
+  bool verbose = false;
+
+  // Pattern starts are logged while rendering frame by frame, if set.
+  std::vector<Position> *positions = nullptr;
+  size_t frame = 0;
+  int order = -1;
+  size_t row_count = 0;  // Rows reported by the callbacks.
+  size_t song_end_count = 0;
+};
+
+//------------------------------------------------------------------------------
+/// Session of the current thread, for event callbacks.
+thread_local Session *t_session = nullptr;
+
+//------------------------------------------------------------------------------
+/// Mixing frequency of all sessions, set by --rate.
+uint32_t g_mixing_freq = mod8::config::MIXING_FREQ;
+
+//------------------------------------------------------------------------------
+/// Set for the threads of the batch modes, whose diagnostics would interleave.
+thread_local bool t_quiet = false;
+
 //------------------------------------------------------------------------------
-std::vector<uint8_t> g_song;
-mod8::Player g_player;
+bool is_verbose() {
+  return t_session != nullptr && t_session->verbose;
+}
 
 //------------------------------------------------------------------------------
 const std::string RULER_THICK(62, '=');
@@ -53,59 +120,696 @@ void print_dec(uint16_t n, int digits, char zero) {
   printf("%0*d", digits, n);
 }
 
-// clang-format off
-
-//------------------------------------------------------------------------------
-struct WavHeader {
-  uint8_t riff_chunk_id[4];
-  uint8_t riff_chunk_size[4];
-  uint8_t riff_format[4];
-  uint8_t fmt_chunk_id[4];
-  uint8_t fmt_chunk_size[4];
-  uint8_t fmt_codec[2];
-  uint8_t fmt_num_channels[2];
-  uint8_t fmt_sample_rate[4];
-  uint8_t fmt_byte_rate[4];
-  uint8_t fmt_block_align[2];
-  uint8_t fmt_bits_per_sample[2];
-  uint8_t data_chunk_id[4];
-  uint8_t data_chunk_size[4];
-} wav_header = {
-  'R', 'I', 'F', 'F',                     // $00: riff_chunk_id
-  0x00, 0x00, 0x00, 0x00,                 // $04: riff_chunk_size
-  'W', 'A', 'V', 'E',                     // $08: riff_format
-  
-  // format subchunk
-  'f', 'm', 't', ' ',                     // $0C: fmt_chunk_id
-  0x10, 0x00, 0x00, 0x00,                 // $10: fmt_chunk_size (16 for PCM)
-  0x01, 0x00,                             // $14: fmt_codec (1 for PCM)
-  0x02, 0x00,                             // $16: fmt_num_channels (2 for stereo)
-  0x00, 0x00, 0x00, 0x00,                 // $18: fmt_sample_rate
-  0x00, 0x00, 0x01, 0x00,                 // $1C: fmt_byte_rate
-  0x04, 0x00,                             // $20: fmt_block_align (4 for 16-bit stereo)
-  0x10, 0x00,                             // $22: fmt_bits_per_sample (16)
-  
-  // data subchunk
-  'd', 'a', 't', 'a',                     // $24: data_chunk_id
-  0x00, 0x00, 0x00, 0x00                  // $28: data_chunk_size
+//------------------------------------------------------------------------------
+constexpr size_t FRAMES_PER_BLOCK = 4096;
+
+//------------------------------------------------------------------------------
+/// The sampler may read one byte past the end of a sample, e.g. after 9xx with an offset
+/// beyond the sample length. Keep it deterministic if the sample is the last one in file.
+constexpr size_t SONG_GUARD_SIZE = 16;
+
+#if MOD8_OPTION_EXTERNAL_STORAGE
+//------------------------------------------------------------------------------
+/// Storage address of the song of every session, see mod8::storage::read().
+constexpr uintptr_t SONG_ADDRESS = 0x100;
+#endif
+
+#if TEST_SONG_LAYOUTS
+//------------------------------------------------------------------------------
+/// Song layout made by `mod-to-inc.py --layout`, see make-layouts.py.
+struct SongLayoutEntry {
+  const char *file_name;
+  mod8::format::SongLayout layout;
 };
 
-// clang-format on
+const SongLayoutEntry SONG_LAYOUTS[] = {
+#include "layouts.inc"
+};
+#endif
+
+//------------------------------------------------------------------------------
+bool read_file(const char *file_name, std::vector<uint8_t> &data) {
+  using FilePtr = std::unique_ptr<FILE, decltype(&fclose)>;
+
+  FILE *file = nullptr;
+  fopen_s(&file, file_name, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Unable to open file: %s\n", file_name);
+    return false;
+  }
+
+  FilePtr file_scope(file, &fclose);
+
+  if (fseek(file, 0, SEEK_END) == 0) {
+    const long file_size = ftell(file);
+    if (file_size >= 0) {
+      const size_t data_size = static_cast<size_t>(file_size);
+      data.resize(data_size);
+
+      rewind(file);
+      if (fread(data.data(), 1, data_size, file) != data_size) {
+        fprintf(stderr, "Unable to read %zu bytes from file: %s\n", data_size, file_name);
+        return false;
+      }
+    }
+  } else {
+    fprintf(stderr, "Unable to seek file: %s\n", file_name);
+    return false;
+  }
+
+  if (data.empty()) {
+    fprintf(stderr, "File is empty: %s\n", file_name);
+    return false;
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+/// Loads the song of the session into the player, which may be another one than the session's.
+template <typename SessionPlayer>
+bool load_player(const char *file_name, const Session &session, SessionPlayer &player) {
+  if (!player.init(g_mixing_freq)) {
+    fprintf(stderr, "Unsupported mixing frequency: %u [Hz]\n", static_cast<unsigned>(g_mixing_freq));
+    return false;
+  }
+
+#if MOD8_OPTION_EXTERNAL_STORAGE
+  const auto *const song_data = reinterpret_cast<const uint8_t *>(SONG_ADDRESS);
+#else
+  const uint8_t *const song_data = session.song.data();
+#endif
+
+#if TEST_SONG_LAYOUTS
+  // The layout was made for the song of the same name.
+  const std::string name = std::filesystem::path(file_name).filename().string();
+  const auto *const entry = std::find_if(std::begin(SONG_LAYOUTS),
+                                         std::end(SONG_LAYOUTS),
+                                         [&](const SongLayoutEntry &layout) { return name == layout.file_name; });
+  if (entry == std::end(SONG_LAYOUTS)) {
+    fprintf(stderr, "No layout of the song: %s\n", file_name);
+    return false;
+  }
+
+  const bool loaded = player.load(song_data, &entry->layout);
+#else
+  const bool loaded = player.load(song_data, session.song_size);
+#endif
+
+  if (!loaded) {
+    fprintf(stderr, "Parse error: %s\n", file_name);
+    return false;
+  }
 
-static_assert(sizeof(WavHeader) == 44);
+  return true;
+}
 
 //------------------------------------------------------------------------------
-constexpr void u32_to_le(uint32_t value, uint8_t (&output)[4]) {
-  output[0] = (value >> 0x00U) & 0xFFU;
-  output[1] = (value >> 0x08U) & 0xFFU;
-  output[2] = (value >> 0x10U) & 0xFFU;
-  output[3] = (value >> 0x18U) & 0xFFU;
+/// Loads the song of the session, e.g. again after changing it.
+bool load_session(const char *file_name, Session &session) {
+  t_session = &session;
+  return load_player(file_name, session, session.player);
 }
 
 //------------------------------------------------------------------------------
-constexpr void u16_to_le(uint16_t value, uint8_t (&output)[2]) {
-  output[0] = (value >> 0x00U) & 0xFFU;
-  output[1] = (value >> 0x08U) & 0xFFU;
+/// Reads and loads the song into the session.
+bool open_session(const char *file_name, Session &session) {
+  if (!read_file(file_name, session.song)) {
+    return false;
+  }
+
+  session.song_size = session.song.size();
+  session.song.resize(session.song_size + SONG_GUARD_SIZE);
+
+  return load_session(file_name, session);
+}
+
+//------------------------------------------------------------------------------
+/// Renders the loaded song into the sink block by block.
+/// @return false if the sink failed.
+bool render(Session &session, sink::Sink &sink) {
+  std::vector<int16_t> frames(FRAMES_PER_BLOCK * 2);
+
+  for (;;) {
+    const size_t frame_count = session.player.render(frames.data(), FRAMES_PER_BLOCK);
+    if (frame_count == 0) {
+      break;
+    }
+
+    if (!sink.write(frames.data(), frame_count)) {
+      return false;
+    }
+  }
+
+  return sink.finish();
+}
+
+//------------------------------------------------------------------------------
+/// Renders the song to `<file_name>.wav`, printing the player events.
+int play_song(const char *file_name) {
+  using FilePtr = std::unique_ptr<FILE, decltype(&fclose)>;
+
+  auto session = std::make_unique<Session>();
+  session->verbose = true;
+
+  if (!open_session(file_name, *session)) {
+    return EXIT_FAILURE;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::string output_file_name = std::string(file_name) + ".wav";
+  FILE *output_file = nullptr;
+  fopen_s(&output_file, output_file_name.c_str(), "wb");
+  if (output_file == nullptr) {
+    fprintf(
+      stderr, "Unable to open output file for writing: %s\n", output_file_name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  FilePtr output_file_scope(output_file, &fclose);
+
+  sink::WavFileSink sink(output_file, session->player.get_mixing_freq());
+  if (!sink.start()) {
+    fprintf(stderr, "Unable to write WAV header to file: %s\n", output_file_name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  if (!render(*session, sink)) {
+    fprintf(stderr, "Unable to write WAV data to file: %s\n", output_file_name.c_str());
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+/// Writes raw 16-bit little-endian stereo PCM to stdout, e.g. to pipe it into an encoder.
+int pipe_song(const char *file_name) {
+#if defined(_WIN32)
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  auto session = std::make_unique<Session>();
+  if (!open_session(file_name, *session)) {
+    return EXIT_FAILURE;
+  }
+
+  sink::RawFileSink sink(stdout);
+  if (!render(*session, sink)) {
+    fprintf(stderr, "Unable to write PCM data to stdout\n");
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+/// Renders the song in memory.
+/// @return MD5 of the WAV file image, or an empty string and the error description.
+std::string hash_song(const char *file_name, std::string &error) {
+  auto session = std::make_unique<Session>();
+  if (!open_session(file_name, *session)) {
+    error = "unable to load";
+    return {};
+  }
+
+  // The header holds the data size, so it's scanned before rendering.
+  // render() repeats the last frame once the song is over.
+  const uint32_t duration = session->player.scan_duration();
+  if (duration == Player::INFINITE_DURATION) {
+    t_session = nullptr;
+    error = "the song never ends";
+    return {};
+  }
+
+  sink::WavHashSink sink(session->player.get_mixing_freq(),
+                         (static_cast<size_t>(duration) + 1U) * 2U * sizeof(int16_t));
+  const bool rendered = render(*session, sink);
+  t_session = nullptr;
+
+  if (!rendered) {
+    error = "the rendered length doesn't match the scanned duration";
+    return {};
+  }
+
+  return sink.hex_digest();
+}
+
+//------------------------------------------------------------------------------
+/// Renders the song in memory and compares the MD5 of its WAV image with the reference.
+/// @return Empty string on success, error description otherwise.
+std::string check_song(const std::string &file_name, const std::filesystem::path &hash_dir) {
+  const std::string name = std::filesystem::path(file_name).filename().string();
+
+  std::string expected;
+  {
+    const std::string hash_file_name = (hash_dir / (name + ".wav.md5")).string();
+    std::vector<uint8_t> hash;
+    if (!read_file(hash_file_name.c_str(), hash)) {
+      return "no reference hash";
+    }
+
+    expected.assign(hash.begin(), hash.end());
+    expected.erase(std::find_if(expected.begin(),
+                                expected.end(),
+                                [](char c) { return isspace(static_cast<unsigned char>(c)); }),
+                   expected.end());
+  }
+
+  std::string error;
+  const std::string actual = hash_song(file_name.c_str(), error);
+  if (actual.empty()) {
+    return error;
+  }
+
+  if (actual != expected) {
+    return "the MD5 hash of the WAV data (" + actual + ") doesn't match the reference value "
+         + expected;
+  }
+
+  return {};
+}
+
+//------------------------------------------------------------------------------
+constexpr size_t SEEK_CHECK_FRAMES = FRAMES_PER_BLOCK * 4;
+
+//------------------------------------------------------------------------------
+/// Seeks to every pattern start and compares the output with the playback from the beginning.
+/// Also checks the scanned duration against the playback.
+/// @return Empty string on success, error description otherwise.
+std::string check_seek(const std::string &file_name) {
+  std::vector<Position> positions;
+  std::vector<int16_t> reference;
+
+  {
+    auto session = std::make_unique<Session>();
+    session->positions = &positions;
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    // The events are polled after every frame, so none is dropped.
+    size_t row_events = 0;
+    bool song_end = false;
+    mod8::Event event;
+
+    int16_t frame[2];
+    while (session->player.render(frame, 1) != 0) {
+      reference.insert(reference.end(), frame, frame + 2);
+      ++session->frame;
+
+      while (session->player.poll_event(event)) {
+        if (event.kind == mod8::Event::Kind::ROW) {
+          ++row_events;
+        } else if (event.kind == mod8::Event::Kind::SONG_END) {
+          song_end = true;
+        }
+      }
+    }
+
+    if (row_events != session->row_count || !song_end
+        || session->player.get_dropped_event_count() != 0) {
+      return "queued events don't match the callbacks";
+    }
+  }
+
+  auto session = std::make_unique<Session>();
+  if (!open_session(file_name.c_str(), *session)) {
+    return "unable to load";
+  }
+
+  std::vector<Player::Checkpoint> checkpoints(mod8::format::NUM_ORDERS);
+  std::vector<int16_t> frames(SEEK_CHECK_FRAMES * 2);
+
+  // Without checkpoints first, then with them.
+  for (const bool use_checkpoints : { false, true }) {
+    if (use_checkpoints) {
+      session->player.set_checkpoints(checkpoints.data(), mod8::format::NUM_ORDERS);
+    }
+
+    // render() repeats the last frame once the song is over.
+    session->row_count = 0;
+    session->song_end_count = 0;
+    const uint32_t duration = session->player.scan_duration();
+    if (duration + 1U != reference.size() / 2) {
+      return "scanned duration " + std::to_string(duration) + " doesn't match the playback";
+    }
+
+    // Only the first row is played again after the scan.
+    if (session->row_count != 1 || session->song_end_count != 0) {
+      return "the duration scan calls the playback callbacks";
+    }
+
+    for (const Position &position : positions) {
+      session->row_count = 0;
+      session->song_end_count = 0;
+      if (!session->player.seek(position.order, position.row)) {
+        return "unable to seek to order " + std::to_string(position.order) + " row "
+             + std::to_string(position.row);
+      }
+
+      if (session->row_count != 0 || session->song_end_count != 0) {
+        return "seeking to order " + std::to_string(position.order) + " row "
+             + std::to_string(position.row) + " calls the playback callbacks";
+      }
+
+      const size_t expected = std::min(SEEK_CHECK_FRAMES, reference.size() / 2 - position.frame);
+      const size_t frame_count = session->player.render(frames.data(), SEEK_CHECK_FRAMES);
+
+      if (frame_count < expected
+          || !std::equal(frames.begin(),
+                         frames.begin() + static_cast<std::ptrdiff_t>(expected * 2),
+                         reference.begin() + static_cast<std::ptrdiff_t>(position.frame * 2))) {
+        return "output after seeking to order " + std::to_string(position.order) + " row "
+             + std::to_string(position.row) + " doesn't match the playback"
+             + (use_checkpoints ? " with checkpoints" : "");
+      }
+    }
+  }
+
+  t_session = nullptr;
+  return {};
+}
+
+#if MOD8_PARAM_SFX_VOICES > 0 && !MOD8_INTERNAL_LERP
+//------------------------------------------------------------------------------
+/// Sound effect triggered by check_sfx().
+struct SfxTrigger {
+  size_t frame;
+  uint16_t period;
+  int8_t volume;
+  uint8_t priority;
+};
+
+// The last one takes the voice of the first one, which has a lower priority than the second one.
+const SfxTrigger SFX_TRIGGERS[] = { { FRAMES_PER_BLOCK, 428, 64, 1 },
+                                    { FRAMES_PER_BLOCK * 3, 214, 40, 2 },
+                                    { FRAMES_PER_BLOCK * 5, 856, 64, 3 } };
+
+constexpr size_t SFX_CHECK_FRAMES = FRAMES_PER_BLOCK * 16;
+
+//------------------------------------------------------------------------------
+/// Renders the song and triggers the sound effects on the way, with the non-empty samples in turn.
+/// @param[out] triggered results of trigger_sfx().
+void render_with_sfx(Session &session, std::vector<int16_t> &frames, std::vector<bool> &triggered) {
+  const auto *const song = reinterpret_cast<const mod8::format::Song *>(session.song.data());
+  frames.resize(SFX_CHECK_FRAMES * 2);
+
+  size_t rendered = 0;
+  uint8_t sample_no = 0;
+
+  for (const SfxTrigger &trigger : SFX_TRIGGERS) {
+    rendered += session.player.render(frames.data() + rendered * 2, trigger.frame - rendered);
+    if (rendered != trigger.frame) {
+      break;
+    }
+
+    for (uint8_t i = 0; i != mod8::format::NUM_SAMPLES; ++i) {
+      sample_no = static_cast<uint8_t>(sample_no % mod8::format::NUM_SAMPLES + 1U);
+      const mod8::format::Sample &sample = song->samples[sample_no - 1U];
+      if (sample.length_hi != 0 || sample.length_lo > 1) {
+        break;
+      }
+    }
+
+    triggered.push_back(
+      session.player.trigger_sfx(sample_no, trigger.period, trigger.volume, trigger.priority));
+  }
+
+  rendered += session.player.render(frames.data() + rendered * 2, SFX_CHECK_FRAMES - rendered);
+  frames.resize(rendered * 2);
+}
+
+//------------------------------------------------------------------------------
+/// Plays the sound effects over the song and alone, over the song without notes.
+/// The sum of the music and the sound effects alone must be the same, clipped.
+/// @return Empty string on success, error description otherwise.
+std::string check_sfx(const std::string &file_name) {
+  std::vector<int16_t> music;
+  {
+    auto session = std::make_unique<Session>();
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    music.resize(SFX_CHECK_FRAMES * 2);
+    music.resize(session->player.render(music.data(), SFX_CHECK_FRAMES) * 2);
+  }
+
+  std::vector<int16_t> mixed;
+  std::vector<bool> mixed_triggered;
+  {
+    auto session = std::make_unique<Session>();
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    render_with_sfx(*session, mixed, mixed_triggered);
+  }
+
+  std::vector<int16_t> alone;
+  std::vector<bool> alone_triggered;
+  {
+    auto session = std::make_unique<Session>();
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    // Without notes, and the song never ends, so the sound effects aren't stopped.
+    const auto *const song = reinterpret_cast<const mod8::format::Song *>(session->song.data());
+    const size_t pattern_count = *std::max_element(std::begin(song->orders), std::end(song->orders)) + 1U;
+    std::fill_n(session->song.begin() + sizeof(mod8::format::Song),
+                pattern_count * sizeof(mod8::format::BasicPattern<TEST_NUM_CHANNELS>),
+                0);
+
+    if (!load_session(file_name.c_str(), *session)) {
+      return "unable to load without notes";
+    }
+
+    session->player.set_mode(Player::Mode::LOOP_SONG);
+    render_with_sfx(*session, alone, alone_triggered);
+  }
+
+  t_session = nullptr;
+
+  if (mixed.size() != music.size() || alone.size() < mixed.size()) {
+    return "sound effects change the song length";
+  }
+
+  // Without notes, the song may play longer.
+  alone_triggered.resize(mixed_triggered.size());
+
+  if (mixed_triggered.empty() || !mixed_triggered[0] || mixed_triggered != alone_triggered) {
+    return "unable to trigger the sound effects";
+  }
+
+  if (std::all_of(alone.begin(), alone.end(), [](int16_t value) { return value == 0; })) {
+    return "the sound effects are silent";
+  }
+
+  // The player clips the sum of the halves of the output range, then doubles it with 4 channels.
+  constexpr int GAIN = TEST_NUM_CHANNELS == 4 ? 2 : 1;
+
+  // The last frame is repeated once the song is over, the sound effects are stopped then.
+  const size_t mixed_size = mixed.size() == SFX_CHECK_FRAMES * 2 ? mixed.size() : mixed.size() - 2U;
+
+  for (size_t i = 0; i != mixed_size; ++i) {
+    const int expected = std::clamp(music[i] / GAIN + alone[i] / GAIN, -32768 / GAIN, 32767 / GAIN) * GAIN;
+    if (mixed[i] != expected) {
+      return "the sound effects aren't mixed on top of the music at frame " + std::to_string(i / 2);
+    }
+  }
+
+  return {};
+}
+#endif  // MOD8_PARAM_SFX_VOICES > 0 && !MOD8_INTERNAL_LERP
+
+//------------------------------------------------------------------------------
+/// The last value written to TestPort.
+thread_local uint8_t t_port_value = 0;
+
+//------------------------------------------------------------------------------
+/// Port of output::Dac8.
+struct TestPort {
+  static void write(uint8_t value) {
+    t_port_value = value;
+  }
+};
+
+//------------------------------------------------------------------------------
+/// Players of the song in the other output formats.
+struct FormatPlayers {
+  FormatPlayer<mod8::output::StereoPwm8> stereo_pwm8;
+  FormatPlayer<mod8::output::MonoPwm8> mono_pwm8;
+  FormatPlayer<mod8::output::Dac8<TestPort>> dac8;
+  FormatPlayer<mod8::output::StereoPwm10> stereo_pwm10;
+};
+
+constexpr size_t FORMAT_CHECK_FRAMES = FRAMES_PER_BLOCK * 64;
+
+//------------------------------------------------------------------------------
+/// @return true if the frame of the player is the frame of the default one, converted to the format.
+template <typename Output>
+bool is_same_frame(const FormatPlayer<Output> &player, const Player &reference) {
+  const auto expected = Output::format(reference.output_left_s16(), reference.output_right_s16());
+  return memcmp(&expected, &player.output(), sizeof(expected)) == 0;
+}
+
+//------------------------------------------------------------------------------
+/// Plays the song in all output formats along with output::Stereo, calling update() and tick()
+/// for each frame, as the firmware does.
+/// @return Empty string on success, error description otherwise.
+std::string check_formats(const std::string &file_name) {
+  auto session = std::make_unique<Session>();
+  auto players = std::make_unique<FormatPlayers>();
+
+  if (!open_session(file_name.c_str(), *session)) {
+    return "unable to load";
+  }
+
+  if (!load_player(file_name.c_str(), *session, players->stereo_pwm8)
+      || !load_player(file_name.c_str(), *session, players->mono_pwm8)
+      || !load_player(file_name.c_str(), *session, players->dac8)
+      || !load_player(file_name.c_str(), *session, players->stereo_pwm10)) {
+    return "unable to load in the other formats";
+  }
+
+  for (size_t frame = 0; frame != FORMAT_CHECK_FRAMES; ++frame) {
+    const auto result = static_cast<int>(session->player.update());
+    if (static_cast<int>(players->stereo_pwm8.update()) != result
+        || static_cast<int>(players->mono_pwm8.update()) != result
+        || static_cast<int>(players->dac8.update()) != result
+        || static_cast<int>(players->stereo_pwm10.update()) != result) {
+      return "update() returns another result at frame " + std::to_string(frame);
+    }
+
+    if (result == static_cast<int>(Player::UpdateResult::INACTIVE)) {
+      break;
+    }
+
+    const uint8_t dac_value = players->dac8.output().value;
+
+    session->player.tick();
+    players->stereo_pwm8.tick();
+    players->mono_pwm8.tick();
+    players->dac8.tick();
+    players->stereo_pwm10.tick();
+
+    if (t_port_value != dac_value) {
+      return "output::Dac8 doesn't write the previous frame at frame " + std::to_string(frame);
+    }
+
+    if (!is_same_frame(players->stereo_pwm8, session->player)
+        || !is_same_frame(players->mono_pwm8, session->player)
+        || !is_same_frame(players->dac8, session->player)
+        || !is_same_frame(players->stereo_pwm10, session->player)) {
+      return "the output doesn't match output::Stereo at frame " + std::to_string(frame);
+    }
+  }
+
+  t_session = nullptr;
+  return {};
+}
+
+#if MOD8_OPTION_BUFFERED_OUTPUT || !MOD8_OPTION_INCREMENTAL_UPDATE
+//------------------------------------------------------------------------------
+/// Plays the whole song calling update() and tick() for each frame, as the firmware does,
+/// and compares the output with render(). Without MOD8_OPTION_BUFFERED_OUTPUT, the interrupt
+/// would mix the frames between the steps of an incremental tick, so there's no such check then.
+/// @return Empty string on success, error description otherwise.
+std::string check_ticks(const std::string &file_name) {
+  std::vector<int16_t> reference;
+  {
+    auto session = std::make_unique<Session>();
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    int16_t frame[2];
+    while (session->player.render(frame, 1) != 0) {
+      reference.insert(reference.end(), frame, frame + 2);
+    }
+  }
+
+  std::vector<int16_t> ticked;
+  {
+    auto session = std::make_unique<Session>();
+    if (!open_session(file_name.c_str(), *session)) {
+      return "unable to load";
+    }
+
+    while (session->player.update() != Player::UpdateResult::INACTIVE) {
+      session->player.tick();
+      ticked.push_back(session->player.output_left_s16());
+      ticked.push_back(session->player.output_right_s16());
+
+      if (ticked.size() > reference.size()) {
+        return "update() doesn't report the end of the song";
+      }
+    }
+  }
+
+  t_session = nullptr;
+
+#if MOD8_OPTION_BUFFERED_OUTPUT
+  // render() repeats the last frame once the song is over, the buffer has nothing to output then.
+  if (!reference.empty()) {
+    reference.resize(reference.size() - 2U);
+  }
+#endif
+
+  if (ticked.size() != reference.size()) {
+    return "update() reports the end of the song at frame " + std::to_string(ticked.size() / 2)
+         + " instead of " + std::to_string(reference.size() / 2);
+  }
+
+  const auto mismatch = std::mismatch(ticked.begin(), ticked.end(), reference.begin());
+  if (mismatch.first != ticked.end()) {
+    return "the output doesn't match render() at frame "
+         + std::to_string((mismatch.first - ticked.begin()) / 2);
+  }
+
+  return {};
+}
+#endif  // MOD8_OPTION_BUFFERED_OUTPUT || !MOD8_OPTION_INCREMENTAL_UPDATE
+
+//------------------------------------------------------------------------------
+/// Runs the check for all songs on a thread pool.
+template <typename Check>
+int check_songs(const std::vector<std::string> &files, Check check) {
+  std::vector<std::string> errors(files.size());
+  std::atomic<size_t> next_file{ 0 };
+
+  auto worker = [&]() {
+    t_quiet = true;
+
+    for (size_t i = next_file++; i < files.size(); i = next_file++) {
+      errors[i] = check(files[i]);
+    }
+  };
+
+  const unsigned thread_count = std::max(1U, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != thread_count && i != files.size(); ++i) {
+    threads.emplace_back(worker);
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  size_t failed = 0;
+  for (size_t i = 0; i != files.size(); ++i) {
+    if (errors[i].empty()) {
+      printf("PASS: %s\n", files[i].c_str());
+    } else {
+      printf("FAIL: %s: %s\n", files[i].c_str(), errors[i].c_str());
+      ++failed;
+    }
+  }
+
+  printf("%zu of %zu songs passed\n", files.size() - failed, files.size());
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 }
@@ -118,38 +822,72 @@ namespace events {
 
 //------------------------------------------------------------------------------
 void on_song_load_error(const Song &song) {
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("-ERROR-\n");
+#if !MOD8_OPTION_SMALL_RAM
   printf("%s\n", reinterpret_cast<const char *>(song.name));
+#else
+  (void)song;
+#endif
 }
 
 //------------------------------------------------------------------------------
 void on_song_load(const Song &song) {
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("%s\n", RULER_THICK.c_str());
-  printf("MIXF: %i [Hz]\n", mod8::config::MIXING_FREQ);
+  printf("MIXF: %u [Hz]\n", static_cast<unsigned>(t_session->player.get_mixing_freq()));
 
   printf("%s\n", RULER_THIN.c_str());
+#if !MOD8_OPTION_SMALL_RAM
   printf("SONG: %s\n", reinterpret_cast<const char *>(song.name));
+#endif
   printf("%s\n", RULER_THIN.c_str());
   printf("ORDS: %d\n", song.order_count);
   printf("PATS: %d\n", song.pattern_count);
+#if !MOD8_OPTION_SMALL_RAM
   printf("FMTG: %c%c%c%c\n", song.tag[0], song.tag[1], song.tag[2], song.tag[3]);
+#endif
 }
 
 //------------------------------------------------------------------------------
 void on_sample_load(uint8_t sample_no, const Sample &sample) {
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("%s\n", RULER_THIN.c_str());
   printf("SMPL: #%02d\n", sample_no);
   printf("%s\n", RULER_THIN.c_str());
-  printf("ADDR: $%04llX\n", sample.begin - g_song.data());
-  printf("LNGT: $%04llX\n", sample.end - sample.begin);
+#if MOD8_OPTION_EXTERNAL_STORAGE
+  const mod8::memory::SampleAddress song_begin = SONG_ADDRESS;
+#else
+  const mod8::memory::SampleAddress song_begin = t_session->song.data();
+#endif
+
+  printf("ADDR: $%04llX\n", static_cast<unsigned long long>(sample.begin - song_begin));
+  printf("LNGT: $%04llX\n", static_cast<unsigned long long>(sample.end - sample.begin));
   printf("FNTN: $%01X\n", sample.finetune);
   printf("VOLM: $%02X\n", sample.volume);
-  printf("LPST: $%04llX\n", sample.loop_begin - sample.begin);
-  printf("LPLN: $%04llX\n", sample.loop_end - sample.loop_begin);
+  printf("LPST: $%04llX\n", static_cast<unsigned long long>(sample.loop_begin - sample.begin));
+  printf("LPLN: $%04llX\n", static_cast<unsigned long long>(sample.loop_end - sample.loop_begin));
 }
 
 //------------------------------------------------------------------------------
-void on_play_pattern(uint8_t, uint8_t pattern) {
+void on_play_pattern(uint8_t order, uint8_t pattern) {
+  if (t_session != nullptr && t_session->positions != nullptr) {
+    t_session->order = order;
+  }
+
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("%s\n", RULER_THIN.c_str());
   printf("PTRN #%d\n", pattern);
   printf("%s\n", RULER_THIN.c_str());
@@ -157,16 +895,38 @@ void on_play_pattern(uint8_t, uint8_t pattern) {
 
 //------------------------------------------------------------------------------
 void on_play_row_begin(uint8_t row) {
+  if (t_session != nullptr) {
+    ++t_session->row_count;
+  }
+
+  if (t_session != nullptr && t_session->positions != nullptr && t_session->order >= 0) {
+    t_session->positions->push_back(
+      { static_cast<uint8_t>(t_session->order), row, t_session->frame });
+    t_session->order = -1;
+  }
+
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("%02d ", row);
 }
 
 //------------------------------------------------------------------------------
 void on_play_row_end() {
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("\n");
 }
 
 //------------------------------------------------------------------------------
 void on_play_note(uint8_t, uint16_t period, uint8_t sample, uint8_t effect, uint8_t param) {
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("| ");
   print_dec(period, 5, '.');
   printf(" ");
@@ -182,13 +942,22 @@ void on_play_note(uint8_t, uint16_t period, uint8_t sample, uint8_t effect, uint
 
 //------------------------------------------------------------------------------
 void on_play_song_end(const Song &) {
+  if (t_session != nullptr) {
+    ++t_session->song_end_count;
+  }
+
+  if (!is_verbose()) {
+    return;
+  }
+
   printf("%s\n", RULER_THICK.c_str());
 }
 
 //------------------------------------------------------------------------------
 void on_message(bool condition, uint8_t count, ...) {
-  if (!condition)
+  if (t_quiet || !condition) {
     return;
+  }
 
   va_list ap;
   va_start(ap, count);
@@ -209,117 +978,105 @@ void on_message(bool condition, uint8_t count, ...) {
 #endif  // MOD8_OPTION_PLAYER_EVENTS
 
 ////////////////////////////////////////////////////////////////////////////////
-int main(int argc, char *argv[]) {
-  using FilePtr = std::unique_ptr<FILE, decltype(&fclose)>;
+#if MOD8_OPTION_EXTERNAL_STORAGE
 
-  //----------------------------------------------------------------------------
-  if (argc < 2) {
-    fprintf(stderr, "Usage: %s <file.mod>\n", argv[0]);
-    return EXIT_FAILURE;
-  }
+namespace mod8 {
+namespace storage {
 
-  //----------------------------------------------------------------------------
-  {
-    FILE *file = nullptr;
-    fopen_s(&file, argv[1], "rb");
-    if (file == nullptr) {
-      fprintf(stderr, "Unable to open file: %s\n", argv[1]);
-      return EXIT_FAILURE;
-    }
+//------------------------------------------------------------------------------
+/// Reads the song of the session of the thread. Past the end of the song, reads zeros,
+/// as the other builds read the guard bytes.
+void read(uint32_t address, uint8_t *buffer, uint8_t count) {
+  const std::vector<uint8_t> &song = t_session->song;
 
-    FilePtr file_scope(file, &fclose);
+  for (uint8_t i = 0; i != count; ++i) {
+    const size_t offset = address + i - SONG_ADDRESS;
+    buffer[i] = offset < song.size() ? song[offset] : 0;
+  }
+}
 
-    if (fseek(file, 0, SEEK_END) == 0) {
-      const long file_size = ftell(file);
-      if (file_size >= 0) {
-        const size_t song_size = static_cast<size_t>(file_size);
-        g_song.resize(song_size);
+}  // namespace storage
+}  // namespace mod8
 
-        rewind(file);
-        if (fread(g_song.data(), 1, song_size, file) != song_size) {
-          fprintf(stderr, "Unable to read %zu bytes from file: %s\n", song_size, argv[1]);
-          return EXIT_FAILURE;
-        }
-      }
-    } else {
-      fprintf(stderr, "Unable to seek file: %s\n", argv[1]);
-      return EXIT_FAILURE;
-    }
-  }
+#endif  // MOD8_OPTION_EXTERNAL_STORAGE
 
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
   //----------------------------------------------------------------------------
-  if (g_song.empty()) {
-    fprintf(stderr, "File is empty: %s\n", argv[1]);
-    return EXIT_FAILURE;
+  // The rate applies to any of the modes below, which parse the rest of the arguments.
+  if (argc >= 4 && std::string(argv[1]) == "--rate") {
+    g_mixing_freq = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+    argv[2] = argv[0];
+    argv += 2;
+    argc -= 2;
   }
 
   //----------------------------------------------------------------------------
-  g_player.init();
-  if (!g_player.load(g_song.data(), g_song.size())) {
-    fprintf(stderr, "Parse error: %s\n", argv[1]);
-    return EXIT_FAILURE;
+  if (argc == 2) {
+    return play_song(argv[1]);
   }
 
   //----------------------------------------------------------------------------
-  const std::string output_file_name = std::string(argv[1]) + ".wav";
-  FILE *output_file = nullptr;
-  fopen_s(&output_file, output_file_name.c_str(), "wb");
-  if (output_file == nullptr) {
-    fprintf(
-      stderr, "Unable to open output file for writing: %s\n", output_file_name.c_str());
-    return EXIT_FAILURE;
+  if (argc == 3 && std::string(argv[1]) == "--raw") {
+    return pipe_song(argv[2]);
   }
 
-  FilePtr output_file_scope(output_file, &fclose);
+  //----------------------------------------------------------------------------
+  if (argc == 3 && std::string(argv[1]) == "--md5") {
+    std::string error;
+    const std::string digest = hash_song(argv[2], error);
+    if (digest.empty()) {
+      fprintf(stderr, "%s: %s\n", argv[2], error.c_str());
+      return EXIT_FAILURE;
+    }
 
-  if (fwrite(&wav_header, sizeof(wav_header), 1, output_file) != 1) {
-    fprintf(stderr, "Unable to write WAV header to file: %s\n", output_file_name.c_str());
-    return EXIT_FAILURE;
+    printf("%s\n", digest.c_str());
+    return EXIT_SUCCESS;
   }
 
   //----------------------------------------------------------------------------
-  size_t data_size = 0;
-
-  while (g_player.update() != mod8::Player::UpdateResult::INACTIVE) {
-    g_player.tick();
-
-    const int16_t sample_l = g_player.output_left_s16();
-    const int16_t sample_r = g_player.output_right_s16();
-
-    uint8_t out_l[2];
-    u16_to_le(static_cast<uint16_t>(sample_l), out_l);
-    uint8_t out_r[2];
-    u16_to_le(static_cast<uint16_t>(sample_r), out_r);
+  if (argc >= 4 && std::string(argv[1]) == "--check") {
+    const std::filesystem::path hash_dir = argv[2];
+    return check_songs(std::vector<std::string>(argv + 3, argv + argc),
+                       [&](const std::string &file_name) { return check_song(file_name, hash_dir); });
+  }
 
-    if (fwrite(&out_l[0], sizeof(out_l), 1, output_file) != 1) {
-      fprintf(stderr, "Unable to write WAV data to file: %s\n", output_file_name.c_str());
-      return EXIT_FAILURE;
-    }
+  //----------------------------------------------------------------------------
+  if (argc >= 3 && std::string(argv[1]) == "--seek") {
+    return check_songs(std::vector<std::string>(argv + 2, argv + argc), check_seek);
+  }
 
-    if (fwrite(&out_r[0], sizeof(out_r), 1, output_file) != 1) {
-      fprintf(stderr, "Unable to write WAV data to file: %s\n", output_file_name.c_str());
-      return EXIT_FAILURE;
-    }
+  //----------------------------------------------------------------------------
+  if (argc >= 3 && std::string(argv[1]) == "--formats") {
+    return check_songs(std::vector<std::string>(argv + 2, argv + argc), check_formats);
+  }
 
-    data_size += sizeof(out_l);
-    data_size += sizeof(out_r);
+#if MOD8_OPTION_BUFFERED_OUTPUT || !MOD8_OPTION_INCREMENTAL_UPDATE
+  //----------------------------------------------------------------------------
+  if (argc >= 3 && std::string(argv[1]) == "--ticks") {
+    return check_songs(std::vector<std::string>(argv + 2, argv + argc), check_ticks);
   }
+#endif
 
+#if MOD8_PARAM_SFX_VOICES > 0 && !MOD8_INTERNAL_LERP
   //----------------------------------------------------------------------------
-  constexpr size_t BLOCK_SIZE = 2 * sizeof(int16_t);
-  constexpr size_t RIFF_HEADER_SIZE = sizeof(WavHeader::riff_chunk_id)
-                                    + sizeof(WavHeader::riff_chunk_size);
-  u32_to_le(mod8::config::MIXING_FREQ, wav_header.fmt_sample_rate);
-  u32_to_le(mod8::config::MIXING_FREQ * BLOCK_SIZE, wav_header.fmt_byte_rate);
-  u32_to_le(static_cast<uint32_t>(data_size + sizeof(WavHeader) - RIFF_HEADER_SIZE),
-            wav_header.data_chunk_size);
-  u32_to_le(static_cast<uint32_t>(data_size), wav_header.data_chunk_size);
-
-  rewind(output_file);
-  if (fwrite(&wav_header, sizeof(wav_header), 1, output_file) != 1) {
-    fprintf(stderr, "Unable to write WAV header to file: %s\n", output_file_name.c_str());
-    return EXIT_FAILURE;
+  if (argc >= 3 && std::string(argv[1]) == "--sfx") {
+    return check_songs(std::vector<std::string>(argv + 2, argv + argc), check_sfx);
   }
+#endif
 
-  return EXIT_SUCCESS;
+  fprintf(stderr, "Usage: %s <file.mod>\n", argv[0]);
+  fprintf(stderr, "       %s --raw <file.mod> > <file.pcm>\n", argv[0]);
+  fprintf(stderr, "       %s --md5 <file.mod>\n", argv[0]);
+  fprintf(stderr, "       %s --check <hash-dir> <file.mod>...\n", argv[0]);
+  fprintf(stderr, "       %s --seek <file.mod>...\n", argv[0]);
+  fprintf(stderr, "       %s --formats <file.mod>...\n", argv[0]);
+#if MOD8_OPTION_BUFFERED_OUTPUT || !MOD8_OPTION_INCREMENTAL_UPDATE
+  fprintf(stderr, "       %s --ticks <file.mod>...\n", argv[0]);
+#endif
+#if MOD8_PARAM_SFX_VOICES > 0 && !MOD8_INTERNAL_LERP
+  fprintf(stderr, "       %s --sfx <file.mod>...\n", argv[0]);
+#endif
+  fprintf(stderr, "       %s --rate <hz> <mode and files>\n", argv[0]);
+  return EXIT_FAILURE;
 }
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2025 Konstantin Polevik
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Writes the layouts of the songs made by extras/songs/mod-to-inc.py --layout,
+# as the initializers of the SONG_LAYOUTS entries of the test application.
+#
+import argparse
+import importlib.util
+import os
+import sys
+
+
+def load_converter(path):
+    spec = importlib.util.spec_from_file_location("mod_to_inc", path)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Song layout generator")
+    parser.add_argument("-t", "--tool", required=True, help="mod-to-inc.py")
+    parser.add_argument("-o", "--output", required=True, help="output file")
+    parser.add_argument("files", nargs="+", help="MOD files")
+
+    args = parser.parse_args()
+    converter = load_converter(args.tool)
+
+    out = []
+    for file_name in args.files:
+        name = os.path.basename(file_name)
+        with open(file_name, "rb") as f:
+            data = f.read()
+
+        try:
+            layout = converter.to_layout(name, data)
+        except ValueError as error:
+            # The player doesn't load it either.
+            print(f"Skipped: {error}")
+            continue
+
+        out += [f'{{ "{name}",', layout, "},"]
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2025 Konstantin Polevik
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+# Generates short MOD files with random notes and effects, so that the self-checking
+# tests (--seek, the format and option variants) run without the downloaded songs.
+# The songs are noise, only the same seed gives the same files.
+#
+import argparse
+import random
+import struct
+import sys
+
+NUM_SAMPLES = 31
+NUM_ROWS = 64
+
+TAGS = {4: b"M.K.", 6: b"6CHN", 8: b"8CHN"}
+
+PERIODS = [
+    856, 808, 762, 720, 678, 640, 604, 570, 538, 508, 480, 453,
+    428, 404, 381, 360, 339, 320, 302, 285, 269, 254, 240, 226,
+    214, 202, 190, 180, 170, 160, 151, 143, 135, 127, 120, 113,
+]
+
+EFFECTS = [0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF]
+EXTENDED_EFFECTS = [0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE]
+
+
+def make_samples(rng):
+    """Headers and data of 8 random samples, the rest are empty."""
+    headers = []
+    data = []
+
+    for i in range(NUM_SAMPLES):
+        if i >= 8:
+            headers.append((0, 0, 0, 0, 2))
+            data.append(b"")
+            continue
+
+        length = rng.choice([64, 200, 1000, 3000, 6000])
+        finetune = rng.randrange(16) if rng.random() < 0.4 else 0
+        volume = rng.randrange(65)
+
+        if rng.random() < 0.5:
+            # At least a half of the sample, longer than the step of the sampling position.
+            loop_start = rng.randrange(length // 2) & ~1
+            loop_length = rng.randrange((length - loop_start) // 2, length - loop_start + 1) & ~1
+        else:
+            loop_start, loop_length = 0, 2
+
+        headers.append((length, finetune, volume, loop_start, loop_length))
+        data.append(bytes(rng.randrange(256) for _ in range(length)))
+
+    return headers, data
+
+
+def make_note(rng):
+    """Four bytes of a random note."""
+    sample, period = 0, 0
+    if rng.random() < 0.5:
+        sample = rng.randrange(1, 9) if rng.random() < 0.8 else 0
+        period = rng.choice(PERIODS) if rng.random() < 0.85 else rng.randrange(100, 900)
+
+    effect, param = 0, 0
+    if rng.random() < 0.5:
+        effect = rng.choice(EFFECTS)
+        param = rng.randrange(256)
+        if effect in (0xB, 0xD) and rng.random() < 0.7:
+            effect, param = 0, 0
+        elif effect == 0xF and rng.random() < 0.5:
+            param = rng.randrange(1, 32)
+        elif effect == 0xE:
+            param = (rng.choice(EXTENDED_EFFECTS) << 4) | rng.randrange(16)
+
+    return bytes([(sample & 0xF0) | (period >> 8), period & 0xFF, ((sample & 0xF) << 4) | effect, param])
+
+
+def make_song(seed, channels):
+    rng = random.Random(seed)
+
+    header = bytearray(f"random {seed}".encode().ljust(20, b"\0"))
+
+    samples, sample_data = make_samples(rng)
+    for i, (length, finetune, volume, loop_start, loop_length) in enumerate(samples):
+        header += f"sample {i + 1}".encode().ljust(22, b"\0")
+        header += struct.pack(">HBBHH", length // 2, finetune, volume, loop_start // 2, loop_length // 2)
+
+    pattern_count = rng.randrange(2, 6)
+    order_count = rng.randrange(2, 10)
+    orders = [rng.randrange(pattern_count) for _ in range(order_count)]
+    header += bytes([order_count, 127]) + bytes(orders + [0] * (128 - order_count)) + TAGS[channels]
+
+    patterns = b"".join(make_note(rng) for _ in range(pattern_count * NUM_ROWS * channels))
+
+    return bytes(header) + patterns + b"".join(sample_data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Random song generator")
+    parser.add_argument("-o", "--output", required=True, help="file name prefix, <prefix><N>.mod are written")
+    parser.add_argument("-n", "--count", type=int, default=1, help="number of songs")
+    parser.add_argument("-c", "--channels", type=int, default=4, choices=sorted(TAGS), help="number of channels")
+    parser.add_argument("-s", "--seed", type=int, default=1, help="seed of the first song")
+
+    args = parser.parse_args()
+
+    for i in range(args.count):
+        with open(f"{args.output}{i + 1}.mod", "wb") as f:
+            f.write(make_song(args.seed * 1000 + i, args.channels))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())